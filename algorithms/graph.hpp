@@ -2,29 +2,22 @@
 
 #include <string>
 #include <unordered_map>
-#include <deque>
+#include <unordered_set>
 #include <queue>
 #include <utility>
 
+#include "../containers/small_vector.hpp"
+
 namespace xlib {
   template <
         typename Key = std::string,
-        class Collection = std::deque<Key>,
+        class Collection = container::small_vector<Key, 8>,
         class HashMap = std::unordered_map<Key, Collection>
   >
   class graph {
   private:
     HashMap values;
 
-    static bool isContainsElement(std::queue<Key> q, const Key& key) {
-      while (!q.empty()) {
-        if (q.front() == key)
-          return true;
-        q.pop();
-      }
-      return false;
-    }
-
   public:
     static inline size_t npos = -1;
 
@@ -44,21 +37,21 @@ namespace xlib {
       std::queue<Collection> search_queue;
       search_queue.push(values[from]);
 
-      std::queue<Key> searched;
+      std::unordered_set<Key> searched;
 
       size_t countValuesInLevel = 1;
       for (size_t i = 1; countValuesInLevel != 0; ++i) {
         size_t tempCountValuesInLevel = 0;
         for (size_t j = 0; j < countValuesInLevel; ++j) {
           for (auto& x : search_queue.front()) {
-            if (!isContainsElement(searched, x)) {
+            if (!searched.contains(x)) {
               if (x == to) {
                 return { true, i };
               }
               else if (values.contains(x)) {
                 ++tempCountValuesInLevel;
                 search_queue.push(values[x]);
-                searched.push(x);
+                searched.insert(x);
               }
             }
           }
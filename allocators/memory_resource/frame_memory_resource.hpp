@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm> // std::max, std::find_if, std::rotate
+#include <cstddef> // std::byte, std::size_t, std::max_align_t
+#include <cstdint> // std::uintptr_t
+#include <memory_resource>
+#include <vector>
+
+namespace xlib {
+  // Stack-like bump arena for scoped temporaries, one per thread (see local()).
+  // A frame marks the top of the arena and rewinds it when it goes out of scope, so
+  // everything allocated inside the frame is freed at once:
+  //
+  //   xlib::frame_memory_resource::frame frame;
+  //   std::pmr::vector<int> tmp(frame.resource());
+  //
+  // Frames nest; an object must be allocated from (and must not outlive) the innermost
+  // open frame, e.g. a vector created in an outer frame must not grow inside an inner one.
+  // Deallocating the most recent allocation gives its space back right away, so a single
+  // growing vector doesn't leave its old buffers behind.
+  //
+  // Like stack_memory_resource it bumps a buffer, but when a block is full it continues in
+  // the next one, taken from upstream with twice the size. Blocks are kept after a rewind
+  // and reused by later frames, so a warmed-up thread doesn't call upstream any more.
+  // Every thread (e.g. every thread_pool worker) has its own arena and frames, so tasks
+  // don't need to synchronize; memory from a frame must not be handed to another thread.
+  class frame_memory_resource : public std::pmr::memory_resource {
+  public:
+    struct marker {
+      std::size_t block = 0;
+      std::size_t offset = 0;
+    };
+
+    class frame {
+    private:
+      frame_memory_resource& _arena;
+      marker _marker;
+
+    public:
+      // Frame of the calling thread's arena.
+      frame() : frame(local()) {}
+
+      explicit frame(frame_memory_resource& arena)
+          : _arena(arena), _marker(arena.mark()) {}
+
+      frame(const frame&) = delete;
+      frame& operator=(const frame&) = delete;
+
+      ~frame() {
+        _arena.rewind(_marker);
+      }
+
+      frame_memory_resource* resource() const noexcept {
+        return &_arena;
+      }
+    };
+
+  private:
+    struct block {
+      std::byte* data;
+      std::size_t size;
+    };
+
+    static constexpr std::size_t block_alignment = alignof(std::max_align_t);
+
+    std::pmr::memory_resource* _upstream;
+    std::size_t _next_block_size;
+
+    std::vector<block> _blocks;
+    std::size_t _current = 0; // block being bumped
+    std::size_t _offset = 0;  // top of the arena inside it
+
+    void* _try_bump(std::size_t bytes, std::size_t alignment) noexcept {
+      if (_current >= _blocks.size())
+        return nullptr;
+
+      block& b = _blocks[_current];
+      auto base = reinterpret_cast<std::uintptr_t>(b.data);
+      std::size_t aligned = ((base + _offset + alignment - 1) & ~(alignment - 1)) - base;
+      if (aligned > b.size || b.size - aligned < bytes)
+        return nullptr;
+
+      _offset = aligned + bytes;
+      return b.data + aligned;
+    }
+
+    // Moves to the next block, reusing a cached one if one is big enough.
+    void _next_block(std::size_t bytes, std::size_t alignment) {
+      std::size_t required = bytes + (alignment > block_alignment ? alignment : 0);
+      std::size_t next = _blocks.empty() ? 0 : _current + 1;
+
+      if (next < _blocks.size() && _blocks[next].size < required) {
+        auto fits = std::find_if(_blocks.begin() + next + 1, _blocks.end(), [&](const block& b) { return b.size >= required; });
+        if (fits != _blocks.end()) {
+          std::rotate(_blocks.begin() + next, fits, fits + 1);
+        }
+        else {
+          // blocks after the top are unused, make room for a bigger one
+          for (std::size_t i = next; i < _blocks.size(); ++i)
+            _upstream->deallocate(_blocks[i].data, _blocks[i].size, block_alignment);
+          _blocks.resize(next);
+        }
+      }
+
+      if (next == _blocks.size()) {
+        std::size_t size = std::max(_next_block_size, required);
+        _blocks.reserve(next + 1);
+        _blocks.push_back({static_cast<std::byte*>(_upstream->allocate(size, block_alignment)), size});
+        _next_block_size = size * 2;
+      }
+
+      _current = next;
+      _offset = 0;
+    }
+
+  protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+      if (void* ptr = _try_bump(bytes, alignment))
+        return ptr;
+
+      _next_block(bytes, alignment);
+      return _try_bump(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t) override {
+      if (_current < _blocks.size() && static_cast<std::byte*>(ptr) + bytes == _blocks[_current].data + _offset)
+        _offset = static_cast<std::size_t>(static_cast<std::byte*>(ptr) - _blocks[_current].data);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+
+  public:
+    explicit frame_memory_resource(std::size_t initial_block_size = 64 * 1024,
+                                   std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _upstream(upstream), _next_block_size(std::max(initial_block_size, block_alignment)) {}
+
+    frame_memory_resource(const frame_memory_resource&) = delete;
+    frame_memory_resource& operator=(const frame_memory_resource&) = delete;
+
+    ~frame_memory_resource() override {
+      release();
+    }
+
+    // Arena of the calling thread.
+    static frame_memory_resource& local() {
+      static thread_local frame_memory_resource arena;
+      return arena;
+    }
+
+    marker mark() const noexcept {
+      return {_current, _offset};
+    }
+
+    // Frees everything allocated after m was taken.
+    void rewind(marker m) noexcept {
+      _current = m.block;
+      _offset = m.offset;
+    }
+
+    // Gives every block back to upstream; no frame may be open.
+    void release() noexcept {
+      for (const block& b : _blocks)
+        _upstream->deallocate(b.data, b.size, block_alignment);
+      _blocks.clear();
+      _current = _offset = 0;
+    }
+
+    // Bytes taken from upstream.
+    std::size_t reserved() const noexcept {
+      std::size_t result = 0;
+      for (const block& b : _blocks)
+        result += b.size;
+      return result;
+    }
+  };
+}
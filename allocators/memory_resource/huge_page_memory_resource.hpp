@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm> // std::max
+#include <bit> // std::bit_width
+#include <cstddef> // std::byte, std::size_t
+#include <cstdint> // std::uintptr_t
+#include <memory_resource>
+#include <new> // std::bad_alloc
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace xlib {
+  enum class huge_page_mode {
+    none,        // plain mmap
+    transparent, // mmap + madvise(MADV_HUGEPAGE), the kernel backs it with huge pages if it can
+    hugetlb,     // MAP_HUGETLB from the reserved pool, falling back to transparent
+  };
+
+  struct huge_page_options {
+    huge_page_mode mode = huge_page_mode::transparent;
+    // NUMA node to bind the pages to, or -1 for the default policy.
+    int numa_node = -1;
+    std::size_t huge_page_size = 2 * 1024 * 1024;
+  };
+
+  // Maps every allocation straight from the OS, meant as upstream for the arena and pool
+  // resources. Allocations of at least half a huge page are rounded up to whole huge pages
+  // and aligned to them so the kernel can back them with huge pages; smaller ones are
+  // rounded up to normal pages. Unavailable huge pages or NUMA nodes are not an error:
+  // the memory is then backed by normal pages or allocated with the default policy.
+  // NUMA binding is done with the mbind system call, so libnuma is not needed.
+  // On other systems than Linux it falls back to aligned ::operator new.
+  class huge_page_memory_resource : public std::pmr::memory_resource {
+  private:
+    huge_page_options _options;
+    std::size_t _page_size = 4096;
+
+#ifdef __linux__
+    static void* _map(std::size_t size, int flags) noexcept {
+      void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+      return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    // Maps size bytes aligned to alignment by over-mapping and unmapping the excess.
+    void* _map_aligned(std::size_t size, std::size_t alignment) noexcept {
+      std::size_t extra = alignment > _page_size ? alignment - _page_size : 0;
+      auto* ptr = static_cast<std::byte*>(_map(size + extra, 0));
+      if (ptr == nullptr || extra == 0)
+        return ptr;
+
+      auto address = reinterpret_cast<std::uintptr_t>(ptr);
+      std::size_t head = (alignment - address % alignment) % alignment;
+      if (head != 0)
+        ::munmap(ptr, head);
+      if (extra - head != 0)
+        ::munmap(ptr + head + size, extra - head);
+      return ptr + head;
+    }
+
+    int _hugetlb_flags() const noexcept {
+      int flags = MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+      flags |= (std::bit_width(_options.huge_page_size) - 1) << MAP_HUGE_SHIFT;
+#endif
+      return flags;
+    }
+
+    void _bind(void* ptr, std::size_t size) const noexcept {
+      constexpr int mpol_bind = 2;
+      constexpr std::size_t mask_bits = 1024;
+      if (_options.numa_node < 0 || static_cast<std::size_t>(_options.numa_node) >= mask_bits)
+        return;
+
+      unsigned long mask[mask_bits / (8 * sizeof(unsigned long))] = {};
+      std::size_t node = static_cast<std::size_t>(_options.numa_node);
+      mask[node / (8 * sizeof(unsigned long))] = 1ul << (node % (8 * sizeof(unsigned long)));
+      // errors (e.g. no such node) leave the default policy in place
+      ::syscall(SYS_mbind, ptr, size, mpol_bind, mask, mask_bits + 1, 0);
+    }
+#endif
+
+    bool _is_huge(std::size_t bytes) const noexcept {
+      return _options.mode != huge_page_mode::none && bytes >= _options.huge_page_size / 2;
+    }
+
+    std::size_t _mapping_size(std::size_t bytes) const noexcept {
+      std::size_t granule = _is_huge(bytes) ? _options.huge_page_size : _page_size;
+      return (std::max(bytes, std::size_t(1)) + granule - 1) / granule * granule;
+    }
+
+  protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+#ifdef __linux__
+      std::size_t size = _mapping_size(bytes);
+      void* ptr = nullptr;
+
+      if (_is_huge(bytes) && _options.mode == huge_page_mode::hugetlb && alignment <= _options.huge_page_size)
+        ptr = _map(size, _hugetlb_flags());
+
+      if (ptr == nullptr) {
+        ptr = _map_aligned(size, std::max(alignment, _is_huge(bytes) ? _options.huge_page_size : _page_size));
+        if (ptr == nullptr)
+          throw std::bad_alloc();
+        if (_is_huge(bytes))
+          ::madvise(ptr, size, MADV_HUGEPAGE);
+      }
+
+      _bind(ptr, size);
+      return ptr;
+#else
+      return ::operator new(bytes, static_cast<std::align_val_t>(alignment));
+#endif
+    }
+
+    void do_deallocate(void* ptr, [[maybe_unused]] std::size_t bytes, [[maybe_unused]] std::size_t alignment) override {
+#ifdef __linux__
+      ::munmap(ptr, _mapping_size(bytes));
+#else
+      ::operator delete(ptr, static_cast<std::align_val_t>(alignment));
+#endif
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+
+  public:
+    explicit huge_page_memory_resource(huge_page_options options = {})
+        : _options(options) {
+#ifdef __linux__
+      long page_size = ::sysconf(_SC_PAGESIZE);
+      if (page_size > 0)
+        _page_size = static_cast<std::size_t>(page_size);
+#endif
+    }
+
+    const huge_page_options& options() const noexcept {
+      return _options;
+    }
+  };
+}
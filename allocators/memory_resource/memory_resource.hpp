@@ -1,5 +1,11 @@
 #pragma once
 
+#include "./frame_memory_resource.hpp"
 #include "./heap_memory_resource.hpp"
+#include "./huge_page_memory_resource.hpp"
+#include "./monotonic_memory_resource.hpp"
+#include "./size_class_memory_resource.hpp"
+#include "./slab_memory_resource.hpp"
 #include "./stack_memory_resource.hpp"
+#include "./tracking_memory_resource.hpp"
 
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm> // std::max
+#include <cstddef> // std::byte, std::size_t, std::max_align_t
+#include <cstdint> // std::uintptr_t
+#include <memory_resource>
+#include <utility> // std::swap
+
+namespace xlib {
+  // Arena which bump-allocates from an optional initial buffer (e.g. on the stack) and
+  // then from blocks taken from upstream, each growth_factor times bigger than the last.
+  // deallocate() is a no-op; memory comes back all at once:
+  //  - reset() rewinds the arena and keeps the biggest upstream block for the next round,
+  //    so a per-request arena stops calling upstream once it has seen its largest request;
+  //  - release() rewinds the arena and gives every upstream block back.
+  class monotonic_memory_resource : public std::pmr::memory_resource {
+  private:
+    struct block_header {
+      block_header* prev;
+      std::size_t size; // including the header
+    };
+
+    static constexpr std::size_t block_alignment = alignof(std::max_align_t);
+    static constexpr std::size_t growth_factor = 2;
+
+    std::pmr::memory_resource* _upstream;
+
+    std::byte* _buffer = nullptr;
+    std::size_t _buffer_size = 0;
+
+    std::byte* _current = nullptr;
+    std::byte* _end = nullptr;
+
+    block_header* _blocks = nullptr; // the block being bumped and the ones before it
+    block_header* _spare = nullptr;  // kept by reset()
+
+    std::size_t _initial_block_size;
+    std::size_t _next_block_size;
+
+    void* _try_bump(std::size_t bytes, std::size_t alignment) noexcept {
+      auto current = reinterpret_cast<std::uintptr_t>(_current);
+      auto end = reinterpret_cast<std::uintptr_t>(_end);
+      std::uintptr_t aligned = (current + alignment - 1) & ~(alignment - 1);
+      if (_current == nullptr || aligned > end || end - aligned < bytes)
+        return nullptr;
+
+      _current = reinterpret_cast<std::byte*>(aligned + bytes);
+      return reinterpret_cast<void*>(aligned);
+    }
+
+    void _use_block(block_header* block) noexcept {
+      block->prev = _blocks;
+      _blocks = block;
+      _current = reinterpret_cast<std::byte*>(block + 1);
+      _end = reinterpret_cast<std::byte*>(block) + block->size;
+    }
+
+    void _add_block(std::size_t bytes, std::size_t alignment) {
+      std::size_t required = sizeof(block_header) + bytes + (alignment > block_alignment ? alignment : 0);
+
+      if (_spare != nullptr && _spare->size >= required) {
+        block_header* spare = _spare;
+        _spare = nullptr;
+        _use_block(spare);
+        return;
+      }
+
+      std::size_t size = std::max(_next_block_size, required);
+      auto* block = static_cast<block_header*>(_upstream->allocate(size, block_alignment));
+      block->size = size;
+      _use_block(block);
+
+      _next_block_size = size * growth_factor;
+    }
+
+    void _free_block(block_header* block) noexcept {
+      _upstream->deallocate(block, block->size, block_alignment);
+    }
+
+    void _rewind() noexcept {
+      _blocks = nullptr;
+      _current = _buffer;
+      _end = _buffer + _buffer_size;
+    }
+
+  protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+      if (void* ptr = _try_bump(bytes, alignment))
+        return ptr;
+
+      _add_block(bytes, alignment);
+      return _try_bump(bytes, alignment);
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+
+  public:
+    explicit monotonic_memory_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : monotonic_memory_resource(1024, upstream) {}
+
+    // initial_block_size is the size of the first upstream block.
+    explicit monotonic_memory_resource(std::size_t initial_block_size,
+                                       std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : _upstream(upstream)
+        , _initial_block_size(std::max(initial_block_size, 2 * sizeof(block_header)))
+        , _next_block_size(_initial_block_size) {}
+
+    // Allocates from buffer first; the first upstream block is growth_factor times bigger.
+    monotonic_memory_resource(void* buffer, std::size_t size,
+                              std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : monotonic_memory_resource(size * growth_factor, upstream) {
+      _buffer = static_cast<std::byte*>(buffer);
+      _buffer_size = size;
+      _rewind();
+    }
+
+    monotonic_memory_resource(const monotonic_memory_resource&) = delete;
+    monotonic_memory_resource& operator=(const monotonic_memory_resource&) = delete;
+
+    ~monotonic_memory_resource() override {
+      release();
+    }
+
+    // Rewinds the arena, keeping the biggest upstream block for reuse.
+    void reset() noexcept {
+      block_header* keep = _spare;
+      for (block_header* block = _blocks; block != nullptr;) {
+        block_header* prev = block->prev;
+        if (keep == nullptr || block->size > keep->size)
+          std::swap(keep, block);
+        if (block != nullptr)
+          _free_block(block);
+        block = prev;
+      }
+      _spare = keep;
+      _rewind();
+    }
+
+    // Rewinds the arena and gives every block back to upstream.
+    void release() noexcept {
+      for (block_header* block = _blocks; block != nullptr;) {
+        block_header* prev = block->prev;
+        _free_block(block);
+        block = prev;
+      }
+      if (_spare != nullptr)
+        _free_block(_spare);
+      _spare = nullptr;
+      _next_block_size = _initial_block_size;
+      _rewind();
+    }
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {
+      return _upstream;
+    }
+  };
+
+  // monotonic_memory_resource with an N-byte initial buffer inside the object itself,
+  // e.g. on the stack of a request handler.
+  template <std::size_t N>
+  class inline_monotonic_memory_resource : public monotonic_memory_resource {
+  private:
+    alignas(std::max_align_t) std::byte _inline_buffer[N];
+
+  public:
+    explicit inline_monotonic_memory_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : monotonic_memory_resource(_inline_buffer, N, upstream) {}
+  };
+}
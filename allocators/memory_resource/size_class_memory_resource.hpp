@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm> // std::min, std::max
+#include <bit> // std::bit_width
+#include <cstddef> // std::byte, std::size_t, std::max_align_t
+#include <memory_resource>
+#include <mutex>
+#include <type_traits>
+
+#include "../../utility/cache_line.hpp"
+#include "../../utility/ignore_t.hpp"
+#include "../../utility/thread_safety.hpp"
+
+namespace xlib {
+  template <typename = thread_safety<false>>
+  class size_class_memory_resource;
+
+  // Pool resource with segregated size classes: 8, 16..128 in steps of 16, then four
+  // classes per power of two up to 4096 bytes (so at most 25% of a block is wasted).
+  // Every class carves its blocks out of slabs taken from upstream, starting small and
+  // doubling up to max_slab_size, and keeps freed blocks in an intrusive free list.
+  // Since deallocate() is given the size, the class is found by arithmetic and freeing
+  // is O(1), without looking up the owning slab.
+  //
+  // Bigger or over-aligned requests go straight to upstream. Memory is given back to
+  // upstream by release() and on destruction.
+  //
+  // The thread-safe version has a mutex per size class, each on its own cache line, so
+  // threads only contend when they use the same size. Upstream must then be thread-safe too.
+  template <bool is_thread_safety>
+  class size_class_memory_resource<thread_safety<is_thread_safety>> : public std::pmr::memory_resource {
+  public:
+    static constexpr std::size_t max_block_size = 4096;
+    static constexpr std::size_t class_count = 29;
+
+  private:
+    struct free_block {
+      free_block* next;
+    };
+
+    struct slab_header {
+      slab_header* next;
+      std::size_t size;
+    };
+
+    static constexpr std::size_t block_alignment = alignof(std::max_align_t);
+    static constexpr std::size_t slab_header_size = (sizeof(slab_header) + block_alignment - 1) / block_alignment * block_alignment;
+    static constexpr std::size_t min_blocks_per_slab = 8;
+
+    using lock_guard = std::conditional_t<is_thread_safety, std::lock_guard<std::mutex>, ignore_t>;
+
+    struct alignas(is_thread_safety ? cache_line_size : alignof(void*)) size_class {
+      free_block* free = nullptr;
+      std::byte* current = nullptr;
+      std::byte* end = nullptr;
+      slab_header* slabs = nullptr;
+      std::size_t next_slab_size = 0;
+      [[no_unique_address]] std::conditional_t<is_thread_safety, std::mutex, ignore_t> mtx;
+    };
+
+    std::pmr::memory_resource* _upstream;
+    std::size_t _max_slab_size;
+    size_class _classes[class_count];
+
+    void _add_slab(size_class& c, std::size_t block_size) {
+      std::size_t min_size = slab_header_size + min_blocks_per_slab * block_size;
+      std::size_t size = std::max(c.next_slab_size, min_size);
+
+      auto* slab = static_cast<slab_header*>(_upstream->allocate(size, block_alignment));
+      slab->next = c.slabs;
+      slab->size = size;
+      c.slabs = slab;
+      c.next_slab_size = std::max(std::min(size * 2, _max_slab_size), min_size);
+
+      std::byte* first = reinterpret_cast<std::byte*>(slab) + slab_header_size;
+      c.current = first;
+      c.end = first + (size - slab_header_size) / block_size * block_size;
+    }
+
+  public:
+    // Index of the smallest class which fits bytes; bytes must be in [1, max_block_size].
+    static constexpr std::size_t class_index(std::size_t bytes) noexcept {
+      if (bytes <= 8)
+        return 0;
+      if (bytes <= 128)
+        return (bytes + 15) / 16;
+
+      std::size_t p = std::bit_width(bytes - 1) - 1; // bytes is in (2^p, 2^(p+1)]
+      std::size_t step = std::size_t(1) << (p - 2);
+      std::size_t in_group = (bytes - (std::size_t(1) << p) + step - 1) / step; // 1..4
+      return 9 + (p - 7) * 4 + (in_group - 1);
+    }
+
+    static constexpr std::size_t class_size(std::size_t index) noexcept {
+      if (index == 0)
+        return 8;
+      if (index <= 8)
+        return index * 16;
+
+      std::size_t p = (index - 9) / 4 + 7;
+      return (std::size_t(1) << p) + ((index - 9) % 4 + 1) * (std::size_t(1) << (p - 2));
+    }
+
+    static_assert(class_index(max_block_size) == class_count - 1 && class_size(class_count - 1) == max_block_size);
+
+    explicit size_class_memory_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                                        std::size_t max_slab_size = 64 * 1024)
+        : _upstream(upstream), _max_slab_size(max_slab_size) {
+      for (std::size_t i = 0; i < class_count; ++i)
+        _classes[i].next_slab_size = std::min<std::size_t>(4096, _max_slab_size);
+    }
+
+    size_class_memory_resource(const size_class_memory_resource&) = delete;
+    size_class_memory_resource& operator=(const size_class_memory_resource&) = delete;
+
+    ~size_class_memory_resource() override {
+      release();
+    }
+
+    // Gives every slab back to upstream, even if blocks in it are still allocated.
+    void release() noexcept {
+      for (size_class& c : _classes) {
+        lock_guard l(c.mtx);
+        for (slab_header* slab = c.slabs; slab != nullptr;) {
+          slab_header* next = slab->next;
+          _upstream->deallocate(slab, slab->size, block_alignment);
+          slab = next;
+        }
+        c.free = nullptr;
+        c.current = c.end = nullptr;
+        c.slabs = nullptr;
+      }
+    }
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {
+      return _upstream;
+    }
+
+  protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+      if (bytes > max_block_size || alignment > block_alignment)
+        return _upstream->allocate(bytes, alignment);
+
+      // every class but the first is a multiple of 16 = alignof(std::max_align_t)
+      std::size_t index = class_index(std::max({bytes, alignment, std::size_t(1)}));
+      size_class& c = _classes[index];
+      lock_guard l(c.mtx);
+
+      if (c.free != nullptr) {
+        free_block* block = c.free;
+        c.free = block->next;
+        return block;
+      }
+
+      if (c.current == c.end)
+        _add_slab(c, class_size(index));
+
+      void* block = c.current;
+      c.current += class_size(index);
+      return block;
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override {
+      if (bytes > max_block_size || alignment > block_alignment) {
+        _upstream->deallocate(ptr, bytes, alignment);
+        return;
+      }
+
+      size_class& c = _classes[class_index(std::max({bytes, alignment, std::size_t(1)}))];
+      lock_guard l(c.mtx);
+
+      c.free = ::new (ptr) free_block{c.free};
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+  };
+}
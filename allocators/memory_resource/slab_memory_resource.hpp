@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm> // std::max
+#include <bit> // std::bit_ceil
+#include <cstddef> // std::byte, std::size_t, std::max_align_t
+#include <cstdint> // std::uint16_t, std::uintptr_t
+#include <memory> // std::unique_ptr
+#include <memory_resource>
+#include <new>
+
+#include "../../utility/cache_line.hpp"
+
+namespace xlib {
+  // Cache of equally sized objects carved out of slabs, in the style of Bonwick's slab
+  // allocator. Every slab is aligned to its size, so the slab of an object (and its cache) is
+  // found by masking the address and deallocate() needs no size. Slabs move between the
+  // partial, full and empty lists; allocations come from partial slabs first, which keeps
+  // objects of one type packed together, and only a few empty slabs are kept before they
+  // are given back to upstream.
+  //
+  // The free list of a slab is an array of indices next to its header, not links inside the
+  // free objects, so a cache may keep its objects constructed while they are free
+  // ("constructor caching", see object_cache). Consecutive slabs start their objects at
+  // different cache-line offsets ("coloring") so equally indexed objects of different slabs
+  // don't all map to the same cache sets.
+  //
+  // Not thread-safe.
+  class slab_cache {
+  public:
+    using object_function = void (*)(void*);
+
+    static constexpr std::size_t default_slab_size = 64 * 1024;
+    static constexpr std::size_t max_empty_slabs = 1;
+
+  private:
+    using index_t = std::uint16_t;
+    static constexpr std::size_t max_objects_per_slab = static_cast<index_t>(-1);
+    static constexpr std::size_t min_objects_per_slab = 8;
+    static constexpr std::size_t min_colors = 4;
+
+    enum class list_id { partial, full, empty };
+
+    struct slab {
+      slab_cache* cache;
+      slab* prev;
+      slab* next;
+      std::byte* objects;
+      std::size_t in_use;
+      index_t free_head;
+      list_id list;
+
+      index_t* next_free() noexcept { return reinterpret_cast<index_t*>(this + 1); }
+    };
+
+    struct slab_list {
+      slab* head = nullptr;
+      std::size_t size = 0;
+
+      void push(slab* s) noexcept {
+        s->prev = nullptr;
+        s->next = head;
+        if (head != nullptr)
+          head->prev = s;
+        head = s;
+        ++size;
+      }
+
+      void erase(slab* s) noexcept {
+        if (s->prev != nullptr)
+          s->prev->next = s->next;
+        else
+          head = s->next;
+        if (s->next != nullptr)
+          s->next->prev = s->prev;
+        --size;
+      }
+    };
+
+    std::pmr::memory_resource* _upstream;
+    object_function _constructor;
+    object_function _destructor;
+
+    std::size_t _object_size;
+    std::size_t _slab_size;
+    std::size_t _objects_per_slab;
+    std::size_t _first_object;  // offset of the first object without color
+    std::size_t _max_color;
+    std::size_t _color_step;
+    std::size_t _next_color = 0;
+
+    slab_list _lists[3];
+
+    slab_list& _list(list_id id) noexcept { return _lists[static_cast<std::size_t>(id)]; }
+
+    void _move(slab* s, list_id to) noexcept {
+      _list(s->list).erase(s);
+      s->list = to;
+      _list(to).push(s);
+    }
+
+    void _layout(std::size_t alignment) {
+      // header, then the index array, then the (colored) objects
+      auto first_object = [&](std::size_t count) {
+        std::size_t end_of_indices = sizeof(slab) + count * sizeof(index_t);
+        return (end_of_indices + alignment - 1) / alignment * alignment;
+      };
+
+      _color_step = std::max(cache_line_size, alignment);
+
+      std::size_t count = std::min((_slab_size - sizeof(slab)) / (_object_size + sizeof(index_t)), max_objects_per_slab);
+      while (count != 0 && first_object(count) + count * _object_size > _slab_size)
+        --count;
+      // give up a few objects to leave room for min_colors different offsets
+      while (count > min_objects_per_slab && _slab_size - first_object(count) - count * _object_size < (min_colors - 1) * _color_step)
+        --count;
+
+      _objects_per_slab = count;
+      _first_object = first_object(count);
+      _max_color = _slab_size - _first_object - count * _object_size;
+    }
+
+    slab* _new_slab() {
+      auto* s = static_cast<slab*>(_upstream->allocate(_slab_size, _slab_size));
+      s->cache = this;
+      s->objects = reinterpret_cast<std::byte*>(s) + _first_object + _next_color;
+      s->in_use = 0;
+      s->free_head = 0;
+      s->list = list_id::empty;
+
+      _next_color += _color_step;
+      if (_next_color > _max_color)
+        _next_color = 0;
+
+      index_t* next_free = s->next_free();
+      for (std::size_t i = 0; i < _objects_per_slab; ++i)
+        next_free[i] = static_cast<index_t>(i + 1);
+
+      if (_constructor != nullptr) {
+        std::size_t constructed = 0;
+        try {
+          for (; constructed < _objects_per_slab; ++constructed)
+            _constructor(s->objects + constructed * _object_size);
+        }
+        catch (...) {
+          for (std::size_t i = 0; i < constructed && _destructor != nullptr; ++i)
+            _destructor(s->objects + i * _object_size);
+          _upstream->deallocate(s, _slab_size, _slab_size);
+          throw;
+        }
+      }
+
+      _list(list_id::empty).push(s);
+      return s;
+    }
+
+    void _free_slab(slab* s) noexcept {
+      _list(s->list).erase(s);
+      if (_destructor != nullptr) {
+        for (std::size_t i = 0; i < _objects_per_slab; ++i)
+          _destructor(s->objects + i * _object_size);
+      }
+      _upstream->deallocate(s, _slab_size, _slab_size);
+    }
+
+    static slab* _slab_of(void* ptr, std::size_t slab_size) noexcept {
+      return reinterpret_cast<slab*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(slab_size - 1));
+    }
+
+  public:
+    // constructor and destructor, if given, are run on every object when its slab is
+    // created and freed, not on every allocation.
+    slab_cache(std::size_t object_size, std::size_t alignment = alignof(std::max_align_t),
+               std::pmr::memory_resource* upstream = std::pmr::new_delete_resource(),
+               object_function constructor = nullptr, object_function destructor = nullptr,
+               std::size_t slab_size = default_slab_size)
+        : _upstream(upstream), _constructor(constructor), _destructor(destructor)
+        , _object_size((std::max(object_size, std::size_t(1)) + alignment - 1) / alignment * alignment) {
+      std::size_t min_size = sizeof(slab) + alignment + min_objects_per_slab * (_object_size + sizeof(index_t));
+      _slab_size = std::bit_ceil(std::max(slab_size, min_size));
+      _layout(alignment);
+    }
+
+    slab_cache(const slab_cache&) = delete;
+    slab_cache& operator=(const slab_cache&) = delete;
+
+    // Frees every slab, even if objects in it are still allocated.
+    ~slab_cache() {
+      for (slab_list& list : _lists) {
+        while (list.head != nullptr)
+          _free_slab(list.head);
+      }
+    }
+
+    void* allocate() {
+      slab* s = _list(list_id::partial).head;
+      if (s == nullptr)
+        s = _list(list_id::empty).head;
+      if (s == nullptr)
+        s = _new_slab();
+
+      index_t index = s->free_head;
+      s->free_head = s->next_free()[index];
+      ++s->in_use;
+
+      if (s->in_use == _objects_per_slab)
+        _move(s, list_id::full);
+      else if (s->list == list_id::empty)
+        _move(s, list_id::partial);
+
+      return s->objects + index * _object_size;
+    }
+
+    void deallocate(void* ptr) noexcept {
+      slab* s = _slab_of(ptr, _slab_size);
+      auto index = static_cast<index_t>((static_cast<std::byte*>(ptr) - s->objects) / _object_size);
+      s->next_free()[index] = s->free_head;
+      s->free_head = index;
+      --s->in_use;
+
+      if (s->in_use == 0) {
+        if (_list(list_id::empty).size >= max_empty_slabs)
+          _free_slab(s);
+        else
+          _move(s, list_id::empty);
+      }
+      else if (s->list == list_id::full) {
+        _move(s, list_id::partial);
+      }
+    }
+
+    // Cache which allocated ptr; ptr must come from some slab_cache with this slab_size.
+    static slab_cache* owner(void* ptr, std::size_t slab_size = default_slab_size) noexcept {
+      return _slab_of(ptr, slab_size)->cache;
+    }
+
+    // Gives all empty slabs back to upstream.
+    void shrink() noexcept {
+      while (_list(list_id::empty).head != nullptr)
+        _free_slab(_list(list_id::empty).head);
+    }
+
+    std::size_t object_size() const noexcept { return _object_size; }
+    std::size_t slab_size() const noexcept { return _slab_size; }
+    std::size_t objects_per_slab() const noexcept { return _objects_per_slab; }
+
+    std::size_t slab_count() const noexcept {
+      return _lists[0].size + _lists[1].size + _lists[2].size;
+    }
+  };
+
+  // slab_cache of constructed T objects: allocate() hands out an object which is already
+  // constructed, deallocate() takes it back without destroying it. Objects are constructed
+  // and destroyed only when their slab is created or freed, so T should be cheap to reuse
+  // (e.g. a connection with its buffers allocated).
+  template <typename T>
+  class object_cache {
+  private:
+    slab_cache _cache;
+
+  public:
+    explicit object_cache(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _cache(sizeof(T), alignof(T), upstream,
+                 [](void* ptr) { ::new (ptr) T(); },
+                 [](void* ptr) { static_cast<T*>(ptr)->~T(); }) {}
+
+    T* allocate() { return static_cast<T*>(_cache.allocate()); }
+    void deallocate(T* ptr) noexcept { _cache.deallocate(ptr); }
+
+    slab_cache& cache() noexcept { return _cache; }
+  };
+
+  // Memory resource with a slab_cache per object size (rounded up to 8 bytes), created on
+  // first use. Objects of one type therefore share slabs with each other and with nothing
+  // else of a different size. Requests bigger than max_object_size or over-aligned ones go
+  // straight to upstream. Not thread-safe.
+  class slab_memory_resource : public std::pmr::memory_resource {
+  public:
+    static constexpr std::size_t max_object_size = 4096;
+
+  private:
+    static constexpr std::size_t granularity = 8;
+
+    std::pmr::memory_resource* _upstream;
+    std::unique_ptr<slab_cache> _caches[max_object_size / granularity];
+
+    slab_cache& _cache(std::size_t bytes) {
+      std::size_t index = (std::max(bytes, std::size_t(1)) - 1) / granularity;
+      if (_caches[index] == nullptr) {
+        std::size_t size = (index + 1) * granularity;
+        std::size_t alignment = size % alignof(std::max_align_t) == 0 ? alignof(std::max_align_t) : granularity;
+        _caches[index] = std::make_unique<slab_cache>(size, alignment, _upstream);
+      }
+      return *_caches[index];
+    }
+
+    static bool _is_small(std::size_t bytes, std::size_t alignment) noexcept {
+      return bytes <= max_object_size && alignment <= alignof(std::max_align_t);
+    }
+
+  protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+      if (!_is_small(bytes, alignment))
+        return _upstream->allocate(bytes, alignment);
+      // a 16-aligned request is rounded up to a multiple of 16, whose cache is 16-aligned
+      if (alignment > granularity)
+        bytes = (bytes + alignment - 1) / alignment * alignment;
+      return _cache(bytes).allocate();
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override {
+      if (!_is_small(bytes, alignment)) {
+        _upstream->deallocate(ptr, bytes, alignment);
+        return;
+      }
+      free(ptr);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+
+  public:
+    explicit slab_memory_resource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _upstream(upstream) {}
+
+    slab_memory_resource(const slab_memory_resource&) = delete;
+    slab_memory_resource& operator=(const slab_memory_resource&) = delete;
+
+    // Frees a block of at most max_object_size bytes without knowing its size.
+    static void free(void* ptr) noexcept {
+      slab_cache::owner(ptr)->deallocate(ptr);
+    }
+
+    // Gives all empty slabs back to upstream.
+    void shrink() noexcept {
+      for (auto& cache : _caches) {
+        if (cache != nullptr)
+          cache->shrink();
+      }
+    }
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {
+      return _upstream;
+    }
+  };
+}
@@ -1,33 +1,115 @@
 #pragma once
 
+#include <cstddef> // std::size_t, std::max_align_t
+#include <cstdint> // std::uintptr_t
 #include <memory_resource>
 
 namespace xlib {
+  // Bumps a buffer of N bytes inside the object. Freeing the most recent allocation moves the
+  // top back, so push/pop patterns and vectors which grow and shrink reuse the buffer. Blocks
+  // freed out of order are remembered (up to max_holes of them) and reclaimed as soon as the
+  // top reaches them. Alignment padding is remembered the same way, as a hole in front of the
+  // block it aligns. When the buffer is full, allocations go to upstream; the default
+  // null_memory_resource() throws std::bad_alloc.
   template <std::size_t N = 1024 * 1024>
   class stack_memory_resource : public std::pmr::memory_resource {
+  public:
+    static constexpr std::size_t max_holes = 16;
+
   private:
-    char buffer[N];
+    struct hole {
+      char* begin;
+      char* end;
+    };
+
+    alignas(std::max_align_t) char buffer[N];
     char* offset = buffer;
 
+    hole holes[max_holes];
+    std::size_t hole_count = 0;
+
+    std::pmr::memory_resource* upstream;
+
+    bool _owns(void* ptr) const noexcept {
+      auto address = reinterpret_cast<std::uintptr_t>(ptr);
+      auto begin = reinterpret_cast<std::uintptr_t>(buffer);
+      return address >= begin && address < begin + N;
+    }
+
+    void _add_hole(char* begin, char* end) noexcept {
+      // without room the block stays used until release()
+      if (hole_count != max_holes)
+        holes[hole_count++] = {begin, end};
+    }
+
+    // Moves the top down over freed blocks and padding which end right at it.
+    void _reclaim_holes() noexcept {
+      for (std::size_t i = 0; i < hole_count;) {
+        if (holes[i].end == offset) {
+          offset = holes[i].begin;
+          holes[i] = holes[--hole_count];
+          i = 0;
+        }
+        else {
+          ++i;
+        }
+      }
+    }
+
     void* do_allocate(std::size_t bytes, std::size_t aligment) override {
-      if (reinterpret_cast<std::size_t>(offset) % aligment != 0) {
-        offset += aligment - reinterpret_cast<std::size_t>(offset) % aligment;
+      std::size_t used = static_cast<std::size_t>(offset - buffer);
+      std::size_t padding = (aligment - reinterpret_cast<std::uintptr_t>(offset) % aligment) % aligment;
+
+      if (padding > N - used || bytes > N - used - padding)
+        return upstream->allocate(bytes, aligment);
+
+      char* ptr = offset + padding;
+      if (padding != 0)
+        _add_hole(offset, ptr);
+      offset = ptr + bytes;
+      return ptr;
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t aligment) override {
+      if (!_owns(ptr)) {
+        upstream->deallocate(ptr, bytes, aligment);
+        return;
       }
 
-      char* ptr = offset;
+      char* begin = static_cast<char*>(ptr);
+      if (begin + bytes == offset) {
+        offset = begin;
+        _reclaim_holes();
+      }
+      else {
+        _add_hole(begin, begin + bytes);
+      }
+    }
 
-      offset += bytes;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
 
-      if (offset >= buffer + N)
-        throw std::bad_alloc();
+  public:
+    explicit stack_memory_resource(std::pmr::memory_resource* upstream = std::pmr::null_memory_resource())
+        : upstream(upstream) {}
 
-      return ptr;
+    stack_memory_resource(const stack_memory_resource&) = delete;
+    stack_memory_resource& operator=(const stack_memory_resource&) = delete;
+
+    // Frees everything allocated from the buffer (but not from upstream).
+    void release() noexcept {
+      offset = buffer;
+      hole_count = 0;
     }
 
-    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    // Bytes of the buffer below the top.
+    std::size_t used() const noexcept {
+      return static_cast<std::size_t>(offset - buffer);
+    }
 
-    bool do_is_equal(const std::pmr::memory_resource&) const noexcept override {
-      return true;
+    std::pmr::memory_resource* upstream_resource() const noexcept {
+      return upstream;
     }
   };
 }
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit> // std::bit_width
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t, std::uintptr_t
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define XLIB_TRACKING_HAS_BACKTRACE 1
+#endif
+
+namespace xlib {
+  struct tracking_options {
+    // Record the call stack of every sample_every-th allocation; 0 turns sampling off.
+    std::size_t sample_every = 0;
+    // Number of frames kept per sampled stack.
+    std::size_t stack_depth = 8;
+  };
+
+  struct tracking_stats {
+    std::size_t bytes_in_flight = 0;
+    std::size_t allocations_in_flight = 0;
+    std::size_t peak_bytes = 0;
+    std::size_t total_allocations = 0;
+    std::size_t total_bytes = 0;
+  };
+
+  // Sampled allocations from one call stack.
+  struct tracking_call_site {
+    std::uint64_t id = 0;          // hash of frames
+    std::vector<void*> frames;     // return addresses, innermost first (see backtrace_symbols)
+    std::size_t samples = 0;
+    std::size_t sampled_bytes = 0;
+    std::size_t bytes_in_flight = 0;
+  };
+
+  // Forwards to upstream and counts what goes through it: bytes and allocations in flight,
+  // peak usage, totals and a histogram of allocation sizes. The counters are relaxed atomics,
+  // so the resource may be shared between threads (if upstream may).
+  //
+  // With sampling on, every sample_every-th allocation also records its call stack
+  // (where backtrace() is available), which attributes memory to the code that asked for
+  // it. With sampling off the cost is a few uncontended atomic adds per call.
+  class tracking_memory_resource : public std::pmr::memory_resource {
+  public:
+    // Bucket i counts allocations of (2^(i-1), 2^i] bytes; bucket 0 counts 0 and 1 byte.
+    static constexpr std::size_t histogram_size = 64;
+
+  private:
+    std::pmr::memory_resource* _upstream;
+    tracking_options _options;
+
+    std::atomic<std::size_t> _bytes_in_flight = 0;
+    std::atomic<std::size_t> _allocations_in_flight = 0;
+    std::atomic<std::size_t> _peak_bytes = 0;
+    std::atomic<std::size_t> _total_allocations = 0;
+    std::atomic<std::size_t> _total_bytes = 0;
+    std::array<std::atomic<std::size_t>, histogram_size> _histogram = {};
+
+    mutable std::mutex _sites_mtx;
+    std::unordered_map<std::uint64_t, tracking_call_site> _sites;
+    std::unordered_map<void*, std::uint64_t> _sampled; // live sampled allocation -> site id
+
+    static std::size_t _bucket(std::size_t bytes) noexcept {
+      return bytes <= 1 ? 0 : static_cast<std::size_t>(std::bit_width(bytes - 1));
+    }
+
+    void _sample(void* ptr, std::size_t bytes) {
+#ifdef XLIB_TRACKING_HAS_BACKTRACE
+      constexpr std::size_t max_depth = 64;
+      void* frames[max_depth + 1];
+      std::size_t depth = _options.stack_depth < max_depth ? _options.stack_depth : max_depth;
+      // the first frame is this function
+      int count = ::backtrace(frames, static_cast<int>(depth + 1));
+      std::size_t first = count > 0 ? 1 : 0;
+
+      std::uint64_t id = 14695981039346656037ull; // FNV-1a over the addresses
+      for (int i = static_cast<int>(first); i < count; ++i) {
+        id ^= reinterpret_cast<std::uintptr_t>(frames[i]);
+        id *= 1099511628211ull;
+      }
+
+      std::lock_guard l(_sites_mtx);
+      auto [it, inserted] = _sites.try_emplace(id);
+      tracking_call_site& site = it->second;
+      if (inserted) {
+        site.id = id;
+        site.frames.assign(frames + first, frames + (count > 0 ? count : 0));
+      }
+      ++site.samples;
+      site.sampled_bytes += bytes;
+      site.bytes_in_flight += bytes;
+      _sampled.emplace(ptr, id);
+#else
+      (void)ptr;
+      (void)bytes;
+#endif
+    }
+
+    void _unsample(void* ptr, std::size_t bytes) {
+      std::lock_guard l(_sites_mtx);
+      auto it = _sampled.find(ptr);
+      if (it == _sampled.end())
+        return;
+      _sites[it->second].bytes_in_flight -= bytes;
+      _sampled.erase(it);
+    }
+
+  protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+      void* ptr = _upstream->allocate(bytes, alignment);
+
+      std::size_t in_flight = _bytes_in_flight.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+      std::size_t peak = _peak_bytes.load(std::memory_order_relaxed);
+      while (in_flight > peak && !_peak_bytes.compare_exchange_weak(peak, in_flight, std::memory_order_relaxed));
+
+      _allocations_in_flight.fetch_add(1, std::memory_order_relaxed);
+      _total_bytes.fetch_add(bytes, std::memory_order_relaxed);
+      _histogram[_bucket(bytes)].fetch_add(1, std::memory_order_relaxed);
+      std::size_t number = _total_allocations.fetch_add(1, std::memory_order_relaxed);
+
+      if (_options.sample_every != 0 && number % _options.sample_every == 0) {
+        try {
+          _sample(ptr, bytes);
+        }
+        catch (...) {
+          // a lost sample isn't worth failing the allocation
+        }
+      }
+
+      return ptr;
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override {
+      if (_options.sample_every != 0)
+        _unsample(ptr, bytes);
+
+      _bytes_in_flight.fetch_sub(bytes, std::memory_order_relaxed);
+      _allocations_in_flight.fetch_sub(1, std::memory_order_relaxed);
+
+      _upstream->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+
+  public:
+    explicit tracking_memory_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                                      tracking_options options = {})
+        : _upstream(upstream), _options(options) {}
+
+    tracking_memory_resource(const tracking_memory_resource&) = delete;
+    tracking_memory_resource& operator=(const tracking_memory_resource&) = delete;
+
+    tracking_stats stats() const noexcept {
+      return {
+          _bytes_in_flight.load(std::memory_order_relaxed),
+          _allocations_in_flight.load(std::memory_order_relaxed),
+          _peak_bytes.load(std::memory_order_relaxed),
+          _total_allocations.load(std::memory_order_relaxed),
+          _total_bytes.load(std::memory_order_relaxed),
+      };
+    }
+
+    std::array<std::size_t, histogram_size> histogram() const noexcept {
+      std::array<std::size_t, histogram_size> result;
+      for (std::size_t i = 0; i < histogram_size; ++i)
+        result[i] = _histogram[i].load(std::memory_order_relaxed);
+      return result;
+    }
+
+    // Sampled call sites, in no particular order.
+    std::vector<tracking_call_site> call_sites() const {
+      std::lock_guard l(_sites_mtx);
+      std::vector<tracking_call_site> result;
+      result.reserve(_sites.size());
+      for (const auto& [id, site] : _sites)
+        result.push_back(site);
+      return result;
+    }
+
+    // Starts a new peak measurement from the current usage.
+    void reset_peak() noexcept {
+      _peak_bytes.store(_bytes_in_flight.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {
+      return _upstream;
+    }
+  };
+}
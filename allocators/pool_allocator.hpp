@@ -1,8 +1,18 @@
 #pragma once
 
+#include <algorithm> // std::copy, std::min, std::max
+#include <atomic>
+#include <cstddef> // std::byte, std::size_t, std::ptrdiff_t
+#include <cstdint> // std::uint64_t, std::uintptr_t
+#include <deque>
+#include <limits>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <new> // std::bad_alloc, std::bad_array_new_length, std::align_val_t
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "../utility/thread_safety.hpp"
 #include "../utility/ignore_t.hpp"
@@ -11,29 +21,440 @@ namespace xlib {
   template <typename, typename = thread_safety<false>>
   class pool_allocator;
 
-  template <typename T, bool is_thread_safety>
-  class pool_allocator<T, thread_safety<is_thread_safety>> {
-  private:
-    struct pair {
-      bool is_used = false;
-      T data;
-    };
+  // Passed to pool_allocator to let it grow past its initial size.
+  struct pool_growth {
+    // Total number of objects the pool may hold after growing.
+    std::size_t max_count = static_cast<std::size_t>(-1);
+  };
 
-    struct impl_data_t {
-      std::unique_ptr<pair[]> pool;
-      std::mutex mtx;
+  namespace detail {
+    // Free list of fixed-size slots. Links are stored inside the free slots themselves,
+    // so pop() and push() are O(1) and need no per-slot flags.
+    template <bool is_thread_safety>
+    class pool_core {
+    private:
+      struct free_slot {
+        free_slot* next;
+      };
+
+      // Tagged head: the pointer lives in the low pointer_bits bits (user-space addresses on
+      // x86-64 and AArch64 fit in 48), the tag in the rest. Linux with 5-level paging only maps
+      // above 2^47 on request, and _add_chunk() rejects any chunk which doesn't fit anyway.
+      using head_t = std::uint64_t;
+      static_assert(sizeof(void*) <= sizeof(head_t), "xlib::pool_allocator: pointers wider than 64 bits aren't supported");
+      static constexpr unsigned pointer_bits = sizeof(void*) == 8 ? 48 : 32;
+      static constexpr head_t pointer_mask = (head_t(1) << pointer_bits) - 1;
+
+      static free_slot* _pointer(head_t head) noexcept { return reinterpret_cast<free_slot*>(static_cast<std::uintptr_t>(head & pointer_mask)); }
+      static head_t _tag(head_t head) noexcept { return head >> pointer_bits; }
+      static head_t _make_head(head_t tag, free_slot* ptr) noexcept {
+        return (tag << pointer_bits) | static_cast<head_t>(reinterpret_cast<std::uintptr_t>(ptr));
+      }
 
       using lock_guard = std::conditional_t<is_thread_safety, std::lock_guard<std::mutex>, ignore_t>;
 
-      impl_data_t(std::size_t size)
-          : pool(reinterpret_cast<pair*>(
-              ::operator new[](sizeof(pair) * size, static_cast<std::align_val_t>(alignof(pair)))
-          )) {}
+    public:
+      static constexpr std::size_t max_thread_cache_size = 64;
+      static constexpr std::size_t max_chunks = 64;
+
+    private:
+      struct chunk_t {
+        std::byte* data;
+        std::size_t size;
+      };
+
+      std::pmr::memory_resource* _upstream;
+      chunk_t _chunks[max_chunks] = {};
+      std::size_t _chunk_count = 0;
+      std::atomic<std::size_t> _size = 0;
+      std::mutex _grow_mtx;
+
+      std::uint64_t _id = _next_id.fetch_add(1, std::memory_order_relaxed);
+      static inline std::atomic<std::uint64_t> _next_id = 0;
+
+      std::conditional_t<is_thread_safety, std::atomic<head_t>, head_t> _head = 0;
+
+    public:
+      const std::size_t slot_size;
+      const std::size_t slot_align;
+      const std::size_t max_size;
+      const std::size_t thread_cache_size;
+
+    private:
+      void _add_chunk(std::size_t count) {
+        auto* chunk = static_cast<std::byte*>(_upstream->allocate(count * slot_size, slot_align));
+        if constexpr (pointer_bits < sizeof(std::uintptr_t) * 8) {
+          if (reinterpret_cast<std::uintptr_t>(chunk) + (count * slot_size - 1) > pointer_mask) {
+            _upstream->deallocate(chunk, count * slot_size, slot_align);
+            throw std::bad_alloc();
+          }
+        }
+        auto at = [&](std::size_t i) { return reinterpret_cast<free_slot*>(chunk + i * slot_size); };
+        for (std::size_t i = 0; i < count; ++i)
+          ::new (at(i)) free_slot{i + 1 < count ? at(i + 1) : nullptr};
+
+        _chunks[_chunk_count++] = {chunk, count * slot_size};
+        _size.fetch_add(count, std::memory_order_relaxed);
+
+        _push_chain(at(0), at(count - 1));
+      }
+
+      // Adds a chunk as big as the pool so far, or returns false if it may not grow.
+      bool _grow() {
+        lock_guard l(_grow_mtx);
+
+        // somebody else has grown the pool while we were waiting
+        if (_pointer(_load_head()) != nullptr)
+          return true;
+
+        std::size_t current = capacity();
+        std::size_t count = std::min(current == 0 ? std::size_t(1) : current, max_size - current);
+        if (count == 0 || _chunk_count == max_chunks)
+          return false;
+
+        _add_chunk(count);
+        return true;
+      }
+
+      head_t _load_head() const noexcept {
+        if constexpr (is_thread_safety)
+          return _head.load(std::memory_order_acquire);
+        else
+          return _head;
+      }
+
+      // _pop_batch() may read the link of a slot which another thread has just popped and is
+      // writing its value into. That read races with the user's plain write; the result is
+      // thrown away because the head has changed by then, but ThreadSanitizer would still
+      // report it, so the read is left out of its instrumentation.
+#if defined(__GNUC__)
+      __attribute__((no_sanitize_thread))
+#endif
+      static free_slot* _load_next(free_slot* s) noexcept {
+        if constexpr (is_thread_safety) {
+#if defined(__GNUC__)
+          return __atomic_load_n(&s->next, __ATOMIC_RELAXED);
+#else
+          return std::atomic_ref<free_slot*>(s->next).load(std::memory_order_relaxed);
+#endif
+        }
+        else {
+          return s->next;
+        }
+      }
+
+      static void _store_next(free_slot* s, free_slot* next) noexcept {
+        if constexpr (is_thread_safety)
+          std::atomic_ref<free_slot*>(s->next).store(next, std::memory_order_relaxed);
+        else
+          s->next = next;
+      }
+
+      // Pops up to count slots into out with one CAS and returns how many were popped.
+      std::size_t _pop_batch(free_slot** out, std::size_t count) noexcept {
+        if constexpr (is_thread_safety) {
+          head_t old_head = _head.load(std::memory_order_acquire);
+          while (true) {
+            free_slot* first = _pointer(old_head);
+            if (first == nullptr)
+              return 0;
+
+            // Another thread may pop a slot of this chain and overwrite its link while the
+            // chain is walked. A link is only followed after checking that the head hasn't
+            // changed since it was read, so a garbage pointer is never dereferenced.
+            std::size_t popped = 0;
+            free_slot* next = first;
+            bool is_valid = true;
+            while (popped < count && next != nullptr) {
+              out[popped++] = next;
+              next = _load_next(next);
+              if (_head.load(std::memory_order_acquire) != old_head) {
+                is_valid = false;
+                break;
+              }
+            }
+
+            if (!is_valid) {
+              old_head = _head.load(std::memory_order_acquire);
+              continue;
+            }
+
+            if (_head.compare_exchange_weak(old_head, _make_head(_tag(old_head) + 1, next),
+                                            std::memory_order_acquire, std::memory_order_acquire))
+              return popped;
+          }
+        }
+        else {
+          std::size_t popped = 0;
+          free_slot* next = _pointer(_head);
+          while (popped < count && next != nullptr) {
+            out[popped++] = next;
+            next = next->next;
+          }
+          _head = _make_head(0, next);
+          return popped;
+        }
+      }
+
+      // Pushes an already linked chain first -> ... -> last with one CAS.
+      void _push_chain(free_slot* first, free_slot* last) noexcept {
+        if constexpr (is_thread_safety) {
+          head_t old_head = _head.load(std::memory_order_relaxed);
+          do {
+            _store_next(last, _pointer(old_head));
+          } while (!_head.compare_exchange_weak(old_head, _make_head(_tag(old_head) + 1, first),
+                                                std::memory_order_release, std::memory_order_relaxed));
+        }
+        else {
+          last->next = _pointer(_head);
+          _head = _make_head(0, first);
+        }
+      }
+
+      void _push_batch(free_slot* const* slots, std::size_t count) noexcept {
+        for (std::size_t i = 0; i + 1 < count; ++i)
+          _store_next(slots[i], slots[i + 1]);
+        _push_chain(slots[0], slots[count - 1]);
+      }
+
+      struct thread_cache_t {
+        pool_core* owner_ptr = nullptr;
+        std::uint64_t owner_id = 0;
+        std::weak_ptr<pool_core> owner;
+
+        std::size_t count = 0;
+        free_slot* slots[max_thread_cache_size];
+
+        thread_cache_t(const std::shared_ptr<pool_core>& core)
+            : owner_ptr(core.get()), owner_id(core->_id), owner(core) {}
+
+        thread_cache_t(thread_cache_t&& other) noexcept
+            : owner_ptr(other.owner_ptr), owner_id(other.owner_id), owner(std::move(other.owner)), count(other.count) {
+          std::copy(other.slots, other.slots + count, slots);
+          other.count = 0;
+        }
+
+        thread_cache_t& operator=(thread_cache_t&& other) noexcept {
+          flush();
+          owner_ptr = other.owner_ptr;
+          owner_id = other.owner_id;
+          owner = std::move(other.owner);
+          count = other.count;
+          std::copy(other.slots, other.slots + count, slots);
+          other.count = 0;
+          return *this;
+        }
+
+        // Gives all slots back to the pool if it is still alive.
+        void flush() noexcept {
+          if (count == 0)
+            return;
+          if (auto core = owner.lock())
+            core->_push_batch(slots, count);
+          count = 0;
+        }
+
+        ~thread_cache_t() {
+          flush();
+        }
+      };
+
+      // The caches of one thread. The pool may still be used after they are destroyed (from
+      // the destructor of a later-destroyed thread_local or static), so that is recorded in a
+      // trivially destructible flag which stays readable until the thread is gone.
+      struct thread_caches_t {
+        static inline thread_local bool is_destroyed = false;
+
+        std::vector<thread_cache_t> caches;
+
+        ~thread_caches_t() {
+          is_destroyed = true;
+          caches.clear();
+        }
+      };
+
+      static std::vector<thread_cache_t>* _thread_caches() noexcept {
+        if (thread_caches_t::is_destroyed)
+          return nullptr;
+
+        static thread_local thread_caches_t thread_caches;
+        return &thread_caches.caches;
+      }
+
+      // Returns the cache of this thread for core, or nullptr if it has none.
+      static thread_cache_t* _find_thread_cache(const pool_core* core) noexcept {
+        auto* caches = _thread_caches();
+        if (caches == nullptr)
+          return nullptr;
+
+        for (auto& cache : *caches) {
+          if (cache.owner_ptr == core && cache.owner_id == core->_id)
+            return &cache;
+        }
+        return nullptr;
+      }
+
+      // Creates the cache if this thread has none yet. Returns nullptr once the caches of this
+      // thread are destroyed; callers use the shared list then.
+      static thread_cache_t* _thread_cache(const std::shared_ptr<pool_core>& core) {
+        if (thread_cache_t* cache = _find_thread_cache(core.get()))
+          return cache;
+
+        auto* caches = _thread_caches();
+        if (caches == nullptr)
+          return nullptr;
+
+        std::erase_if(*caches, [](const thread_cache_t& cache) { return cache.owner.expired(); });
+        return &caches->emplace_back(core);
+      }
+
+      bool _use_thread_cache() const noexcept {
+        if constexpr (is_thread_safety)
+          return thread_cache_size != 0;
+        else
+          return false;
+      }
+
+    public:
+      pool_core(std::size_t slot_size, std::size_t slot_align, std::size_t size, std::size_t max_size, std::size_t thread_cache_size,
+                std::pmr::memory_resource* upstream)
+          : _upstream(upstream), slot_size(slot_size), slot_align(slot_align)
+          , max_size(max_size < size ? size : max_size)
+          , thread_cache_size(thread_cache_size < max_thread_cache_size ? thread_cache_size : max_thread_cache_size) {
+        if (size != 0)
+          _add_chunk(size);
+      }
+
+      pool_core(const pool_core&) = delete;
+      pool_core& operator=(const pool_core&) = delete;
+
+      ~pool_core() {
+        for (std::size_t i = 0; i < _chunk_count; ++i)
+          _upstream->deallocate(_chunks[i].data, _chunks[i].size, slot_align);
+      }
+
+      std::size_t capacity() const noexcept {
+        return _size.load(std::memory_order_relaxed);
+      }
+
+      // Returns nullptr if the pool is exhausted and may not grow.
+      // Takes the owning shared_ptr because thread caches keep a weak reference to the pool.
+      static void* pop(const std::shared_ptr<pool_core>& core) {
+        free_slot* result = nullptr;
+        thread_cache_t* cache = core->_use_thread_cache() ? _thread_cache(core) : nullptr;
+        do {
+          if (cache != nullptr) {
+            if (cache->count == 0)
+              cache->count = core->_pop_batch(cache->slots, core->thread_cache_size / 2 + 1);
+            if (cache->count != 0)
+              return cache->slots[--cache->count];
+          }
+          else if (core->_pop_batch(&result, 1) != 0) {
+            return result;
+          }
+        } while (core->_grow());
+
+        return nullptr;
+      }
+
+      static void push(const std::shared_ptr<pool_core>& core, void* ptr) noexcept {
+        free_slot* s = ::new (ptr) free_slot;
+
+        // Creating a cache may throw, so only a cache this thread already has is used here.
+        thread_cache_t* cache = core->_use_thread_cache() ? _find_thread_cache(core.get()) : nullptr;
+        if (cache != nullptr) {
+          if (cache->count == core->thread_cache_size) {
+            std::size_t half = (cache->count + 1) / 2;
+            core->_push_batch(cache->slots + (cache->count - half), half);
+            cache->count -= half;
+          }
+          cache->slots[cache->count++] = s;
+          return;
+        }
+
+        core->_push_chain(s, s);
+      }
+    };
+
+    // Pools shared by a pool_allocator and every allocator rebound from it: one pool_core
+    // per slot layout, all created with the same settings.
+    template <bool is_thread_safety>
+    class pool_family {
+    private:
+      std::mutex _mtx;
+      std::deque<std::shared_ptr<pool_core<is_thread_safety>>> _cores; // references stay valid
+
+    public:
+      const std::size_t count;
+      const std::size_t max_count;
+      const std::size_t thread_cache_size;
+      std::pmr::memory_resource* const upstream;
+
+      pool_family(std::size_t count, std::size_t max_count, std::size_t thread_cache_size, std::pmr::memory_resource* upstream)
+          : count(count), max_count(max_count), thread_cache_size(thread_cache_size), upstream(upstream) {}
+
+      template <typename T>
+      const std::shared_ptr<pool_core<is_thread_safety>>& core() {
+        constexpr std::size_t align = std::max(alignof(T), alignof(void*));
+        constexpr std::size_t size = (std::max(sizeof(T), sizeof(void*)) + align - 1) / align * align;
+
+        std::lock_guard l(_mtx);
+        for (auto& core : _cores) {
+          if (core->slot_size == size && core->slot_align == align)
+            return core;
+        }
+        return _cores.emplace_back(std::make_shared<pool_core<is_thread_safety>>(size, align, count, max_count, thread_cache_size, upstream));
+      }
     };
+  }
+
+  // Pool of objects of type T. Free slots form a singly linked list whose links are stored
+  // inside the free slots themselves, so allocate() and deallocate() are O(1) and need no
+  // per-slot flags; a slot pointer is all deallocate() needs, whichever chunk it came from.
+  //
+  // By default the pool has a fixed size and allocate() returns nullptr when it is
+  // exhausted. With pool_growth it chains new chunks instead, each as big as the whole
+  // pool so far, up to pool_growth::max_count objects.
+  //
+  // The thread-safe version keeps the list head as a lock-free stack: the head pointer is
+  // tagged with a counter which changes on every update, so a concurrent pop/push/pop
+  // sequence can't be mistaken for no change (ABA). Only growing takes a mutex.
+  //
+  // In the thread-safe version every thread also keeps a small cache ("magazine") of free
+  // slots per pool. It is refilled from and flushed to the shared list in batches of half its
+  // size with a single CAS, so most allocations and deallocations - including frees of slots
+  // allocated by other threads - never touch the shared head. Slots parked in the caches of
+  // other threads are not visible to allocate(), so a fixed-size pool should be sized with
+  // thread_cache_size free slots per thread to spare (or created with thread_cache_size = 0).
+  //
+  // pool_allocator also meets the Allocator requirements, so it can be given to std::list,
+  // std::map or xlib::container::avl_tree. A rebound copy (e.g. the node allocator of a
+  // container) gets a pool of the same settings for its own slot size; copies and rebinds
+  // compare equal and share their pools. allocate(n) and deallocate(ptr, n) serve single
+  // objects from the pool and fall back to ::operator new for n != 1.
+  template <typename T, bool is_thread_safety>
+  class pool_allocator<T, thread_safety<is_thread_safety>> {
+  private:
+    template <typename, typename>
+    friend class pool_allocator;
 
-    using lock_guard = typename impl_data_t::lock_guard;
+    using family_t = detail::pool_family<is_thread_safety>;
+    using core_t = detail::pool_core<is_thread_safety>;
 
-    std::shared_ptr<impl_data_t> impl_data;
+    std::shared_ptr<family_t> _family;
+    // Owned by _family. Rebound copies find or create it on first use, so rebinding is
+    // noexcept and doesn't allocate; containers may rebind freely.
+    mutable std::atomic<const std::shared_ptr<core_t>*> _core = nullptr;
+
+    const std::shared_ptr<core_t>& _get_core() const {
+      auto* core = _core.load(std::memory_order_acquire);
+      if (core == nullptr) {
+        // racing threads get the same core from the family
+        core = &_family->template core<T>();
+        _core.store(core, std::memory_order_release);
+      }
+      return *core;
+    }
 
   public:
     using value_type = T;
@@ -42,47 +463,98 @@ namespace xlib {
     using reference = T&;
     using const_reference = const T&;
     using size_type = std::size_t;
-    using diffrent_type = std::ptrdiff_t;
+    using difference_type = std::ptrdiff_t;
+    using diffrent_type = difference_type;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    template <typename U>
+    struct rebind {
+      using other = pool_allocator<U, thread_safety<is_thread_safety>>;
+    };
+
+    static constexpr size_type default_thread_cache_size = is_thread_safety ? 32 : 0;
+
+    // Fixed-size pool of count objects.
+    // thread_cache_size is only used by the thread-safe version and is capped at 64.
+    // Chunks are allocated from upstream.
+    pool_allocator(size_type count, size_type thread_cache_size = default_thread_cache_size,
+                   std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _family(std::make_shared<family_t>(count, count, thread_cache_size, upstream))
+        , _core(&_family->template core<T>()) {}
+
+    // Pool which starts with count objects and grows geometrically up to growth.max_count.
+    pool_allocator(size_type count, pool_growth growth, size_type thread_cache_size = default_thread_cache_size,
+                   std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _family(std::make_shared<family_t>(count, growth.max_count, thread_cache_size, upstream))
+        , _core(&_family->template core<T>()) {}
+
+    // Rebinding: a pool of the same family for objects of type T, created on first use.
+    template <typename U>
+    pool_allocator(const pool_allocator<U, thread_safety<is_thread_safety>>& other) noexcept
+        : _family(other._family) {}
 
-    pool_allocator(size_type count) : impl_data(std::make_shared<impl_data_t>(count)) {}
     ~pool_allocator() = default;
 
-    pool_allocator(const pool_allocator&) = default;
-    pool_allocator(pool_allocator&&) = default;
+    // No move operations: a moved-from allocator must still be usable by its container.
+    pool_allocator(const pool_allocator& other) noexcept
+        : _family(other._family)
+        , _core(other._core.load(std::memory_order_acquire)) {}
 
-    pool_allocator& operator=(const pool_allocator&) = delete;
-    pool_allocator& operator=(pool_allocator&&) = delete;
+    pool_allocator& operator=(const pool_allocator& other) noexcept {
+      _core.store(other._core.load(std::memory_order_acquire), std::memory_order_release);
+      _family = other._family;
+      return *this;
+    }
 
+    // Returns nullptr if the pool is exhausted and may not grow.
     pointer allocate() {
-      lock_guard l(impl_data->mtx);
+      return static_cast<pointer>(core_t::pop(_get_core()));
+    }
 
-      for (size_t i = 0; i < impl_data->pool.size(); ++i) {
-        if (!impl_data->pool[i].is_used) {
-          impl_data->pool[i].is_used = true;
-          return &impl_data->pool[i].data;
-        }
+    // Throws std::bad_alloc if the pool is exhausted and may not grow.
+    pointer allocate(size_type n) {
+      if (n != 1) {
+        if (n > std::numeric_limits<size_type>::max() / sizeof(T))
+          throw std::bad_array_new_length();
+        return static_cast<pointer>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
       }
 
-      return nullptr;
+      auto ptr = allocate();
+      if (ptr == nullptr)
+        throw std::bad_alloc();
+      return ptr;
     }
 
+    // Throws std::bad_alloc if the pool is exhausted and may not grow.
     template <typename... Args>
     pointer allocate_construct(Args&&... args) {
-      auto ptr = allocate();
+      auto ptr = allocate(1);
 
-      new (ptr) T(std::forward<Args>(args)...);
+      try {
+        new (ptr) T(std::forward<Args>(args)...);
+      }
+      catch (...) {
+        deallocate(ptr);
+        throw;
+      }
 
       return ptr;
     }
 
-    void deallocate(pointer ptr) {
-      lock_guard l(impl_data->mtx);
-
-      diffrent_type index =
-          reinterpret_cast<char*>(ptr) - reinterpret_cast<char*>(&(impl_data->pool.data()->data));
-      index /= sizeof(value_type);
+    // ptr came from an equal allocator, so the core already exists and this doesn't allocate.
+    void deallocate(pointer ptr) noexcept {
+      core_t::push(_get_core(), ptr);
+    }
 
-      impl_data->pool[index].is_used = false;
+    void deallocate(pointer ptr, size_type n) noexcept {
+      if (n != 1)
+        ::operator delete(ptr, n * sizeof(T), std::align_val_t(alignof(T)));
+      else
+        deallocate(ptr);
     }
 
     void destroy_deallocate(pointer ptr) {
@@ -90,9 +562,18 @@ namespace xlib {
       deallocate(ptr);
     }
 
+    // Number of objects the pool can hold right now.
+    size_type capacity() const {
+      return _get_core()->capacity();
+    }
+
+    size_type max_capacity() const {
+      return _get_core()->max_size;
+    }
+
     template <typename U>
-    struct rebind {
-      using type = pool_allocator<U, thread_safety<is_thread_safety>>;
-    };
+    bool operator==(const pool_allocator<U, thread_safety<is_thread_safety>>& other) const noexcept {
+      return _family == other._family;
+    }
   };
 }
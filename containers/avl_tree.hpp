@@ -117,6 +117,7 @@ namespace xlib::container::detail {
           return false;
 
         _end = ATR_BaseNode::allocate(_BaseNodeAllocator, 1);
+        ATR_BaseNode::construct(_BaseNodeAllocator, _end, nullptr, nullptr);
 
         return true;
       }
@@ -166,12 +167,16 @@ namespace xlib::container::detail {
 
     public:
       avl_tree() = default;
+      explicit avl_tree(const Allocator& allocator)
+          : _NodeAllocator(allocator), _BaseNodeAllocator(allocator) {}
+
       ~avl_tree() {
         if (_end != nullptr) {
           if (_end->left != nullptr && _end->right != nullptr) {
             _end->left->left = _end->right->right = nullptr;
             _end->left = _end->right = nullptr;
           }
+          ATR_BaseNode::destroy(_BaseNodeAllocator, _end);
           ATR_BaseNode::deallocate(_BaseNodeAllocator, _end, 1);
         }
 
@@ -203,12 +208,13 @@ namespace xlib::container::detail {
               }
 
               if (tmp->left == nullptr) {
-                tmp->left = ATR_Node::allocate(_NodeAllocator, 1);
+                Node* node = ATR_Node::allocate(_NodeAllocator, 1);
                 ATR_Node::construct(
-                    _NodeAllocator, toNode(tmp->left),
+                    _NodeAllocator, node,
                     (is_end ? _end : nullptr), nullptr, tmp, std::forward<ValueType>(value)
                 );
-                tmp = toNode(tmp->left);
+                tmp->left = node;
+                tmp = node;
 
                 if (is_end)
                   _end->left = tmp;
@@ -229,12 +235,13 @@ namespace xlib::container::detail {
               }
 
               if (tmp->right == nullptr) {
-                tmp->right = ATR_Node::allocate(_NodeAllocator, 1);
+                Node* node = ATR_Node::allocate(_NodeAllocator, 1);
                 ATR_Node::construct(
-                    _NodeAllocator, toNode(tmp->right),
+                    _NodeAllocator, node,
                     nullptr, (is_end ? _end : nullptr), tmp, std::forward<ValueType>(value)
                 );
-                tmp = toNode(tmp->right);
+                tmp->right = node;
+                tmp = node;
 
                 if (is_end)
                   _end->right = tmp;
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <functional> // std::less
+#include <utility> // std::move, std::forward
+#include <vector>
+
+namespace xlib::container {
+  namespace detail {
+    // Index helpers shared by d_ary_heap and indexed_priority_queue.
+    template <std::size_t D>
+    struct d_ary_layout {
+      static_assert(D >= 2, "xlib::container: heap arity must be at least 2");
+
+      static constexpr std::size_t parent(std::size_t i) noexcept { return (i - 1) / D; }
+      static constexpr std::size_t first_child(std::size_t i) noexcept { return i * D + 1; }
+    };
+  }
+
+  // Implicit D-ary heap. With the default D = 4 a node's children are adjacent in memory
+  // (usually one cache line), and the tree is half as deep as a binary heap.
+  // Unlike std::priority_queue, top() is the *smallest* element with respect to Compare.
+  template <
+      typename T,
+      std::size_t D = 4,
+      class Compare = std::less<T>,
+      class Container = std::vector<T>
+  >
+  class d_ary_heap {
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using container_type = Container;
+    using value_compare = Compare;
+
+  private:
+    using layout = detail::d_ary_layout<D>;
+
+    Container _data;
+    [[no_unique_address]] Compare _compare;
+
+    void _sift_up(size_type i) {
+      T value = std::move(_data[i]);
+      while (i != 0) {
+        size_type up = layout::parent(i);
+        if (!_compare(value, _data[up]))
+          break;
+        _data[i] = std::move(_data[up]);
+        i = up;
+      }
+      _data[i] = std::move(value);
+    }
+
+    void _sift_down(size_type i) {
+      size_type size = _data.size();
+      T value = std::move(_data[i]);
+      while (true) {
+        size_type first = layout::first_child(i);
+        if (first >= size)
+          break;
+
+        size_type last = first + D < size ? first + D : size;
+        size_type best = first;
+        for (size_type child = first + 1; child < last; ++child) {
+          if (_compare(_data[child], _data[best]))
+            best = child;
+        }
+
+        if (!_compare(_data[best], value))
+          break;
+        _data[i] = std::move(_data[best]);
+        i = best;
+      }
+      _data[i] = std::move(value);
+    }
+
+  public:
+    d_ary_heap() = default;
+
+    explicit d_ary_heap(const Compare& compare, Container container = {})
+        : _data(std::move(container)), _compare(compare) {
+      make_heap();
+    }
+
+    bool empty() const noexcept { return _data.empty(); }
+    size_type size() const noexcept { return _data.size(); }
+
+    const T& top() const { return _data.front(); }
+
+    void reserve(size_type count) { _data.reserve(count); }
+    void clear() noexcept { _data.clear(); }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+      _data.emplace_back(std::forward<Args>(args)...);
+      _sift_up(_data.size() - 1);
+    }
+
+    void push(const T& value) { emplace(value); }
+    void push(T&& value) { emplace(std::move(value)); }
+
+    void pop() {
+      if (_data.size() > 1) {
+        _data.front() = std::move(_data.back());
+        _data.pop_back();
+        _sift_down(0);
+      }
+      else {
+        _data.pop_back();
+      }
+    }
+
+    // Moves the top element out and pops it.
+    T extract_top() {
+      T result = std::move(_data.front());
+      pop();
+      return result;
+    }
+
+    // pop() followed by push(value), but with a single sift.
+    void replace_top(T value) {
+      _data.front() = std::move(value);
+      _sift_down(0);
+    }
+
+    // Restores the heap property of the whole container in O(n).
+    void make_heap() {
+      if (_data.size() < 2)
+        return;
+      for (size_type i = layout::parent(_data.size() - 1) + 1; i-- > 0;)
+        _sift_down(i);
+    }
+
+    const Container& container() const noexcept { return _data; }
+  };
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm> // std::min, std::fill
+#include <bit> // std::popcount, std::countr_zero
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+#include <memory> // std::allocator
+#include <stdexcept> // std::out_of_range
+#include <vector>
+
+namespace xlib::container {
+  // Bitset with run-time size. Bulk operations work on whole 64-bit words in plain loops
+  // without branches, which compilers turn into SIMD code (and popcnt for count()).
+  // Binary operations use the common prefix when sizes differ.
+  template <class Allocator = std::allocator<std::uint64_t>>
+  class dynamic_bitset {
+  public:
+    using block_type = std::uint64_t;
+    using size_type = std::size_t;
+
+    static constexpr size_type bits_per_block = 64;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+  private:
+    std::vector<block_type, Allocator> _blocks;
+    size_type _size = 0;
+
+    static size_type _block_count(size_type bits) noexcept {
+      return (bits + bits_per_block - 1) / bits_per_block;
+    }
+
+    static block_type _mask(size_type pos) noexcept {
+      return block_type(1) << (pos % bits_per_block);
+    }
+
+    // Unused bits of the last block must stay zero, count() and comparisons rely on it.
+    void _clear_tail() noexcept {
+      if (_size % bits_per_block != 0)
+        _blocks.back() &= _mask(_size) - 1;
+    }
+
+    void _check(size_type pos) const {
+      if (pos >= _size)
+        throw std::out_of_range("xlib::container::dynamic_bitset: position out of range");
+    }
+
+  public:
+    dynamic_bitset() = default;
+
+    explicit dynamic_bitset(size_type size, bool value = false, const Allocator& allocator = {})
+        : _blocks(_block_count(size), value ? ~block_type(0) : block_type(0), allocator)
+        , _size(size) {
+      _clear_tail();
+    }
+
+    size_type size() const noexcept { return _size; }
+    bool empty() const noexcept { return _size == 0; }
+    size_type num_blocks() const noexcept { return _blocks.size(); }
+
+    block_type* data() noexcept { return _blocks.data(); }
+    const block_type* data() const noexcept { return _blocks.data(); }
+
+    void resize(size_type size, bool value = false) {
+      size_type old_size = _size;
+      _blocks.resize(_block_count(size), value ? ~block_type(0) : block_type(0));
+      _size = size;
+
+      if (value && size > old_size && old_size % bits_per_block != 0)
+        _blocks[old_size / bits_per_block] |= ~(_mask(old_size) - 1);
+      _clear_tail();
+    }
+
+    void push_back(bool value) {
+      resize(_size + 1);
+      if (value)
+        set(_size - 1);
+    }
+
+    void clear() noexcept {
+      _blocks.clear();
+      _size = 0;
+    }
+
+    bool test(size_type pos) const noexcept {
+      return (_blocks[pos / bits_per_block] & _mask(pos)) != 0;
+    }
+
+    bool at(size_type pos) const {
+      _check(pos);
+      return test(pos);
+    }
+
+    bool operator[](size_type pos) const noexcept { return test(pos); }
+
+    // Sets the bit and returns its previous value, which is what visited-sets need.
+    bool test_set(size_type pos) noexcept {
+      block_type& block = _blocks[pos / bits_per_block];
+      bool old = (block & _mask(pos)) != 0;
+      block |= _mask(pos);
+      return old;
+    }
+
+    dynamic_bitset& set(size_type pos) noexcept {
+      _blocks[pos / bits_per_block] |= _mask(pos);
+      return *this;
+    }
+
+    dynamic_bitset& set(size_type pos, bool value) noexcept {
+      return value ? set(pos) : reset(pos);
+    }
+
+    dynamic_bitset& reset(size_type pos) noexcept {
+      _blocks[pos / bits_per_block] &= ~_mask(pos);
+      return *this;
+    }
+
+    dynamic_bitset& flip(size_type pos) noexcept {
+      _blocks[pos / bits_per_block] ^= _mask(pos);
+      return *this;
+    }
+
+    dynamic_bitset& set() noexcept {
+      std::fill(_blocks.begin(), _blocks.end(), ~block_type(0));
+      _clear_tail();
+      return *this;
+    }
+
+    dynamic_bitset& reset() noexcept {
+      std::fill(_blocks.begin(), _blocks.end(), block_type(0));
+      return *this;
+    }
+
+    dynamic_bitset& flip() noexcept {
+      for (auto& block : _blocks)
+        block = ~block;
+      _clear_tail();
+      return *this;
+    }
+
+    size_type count() const noexcept {
+      size_type result = 0;
+      for (block_type block : _blocks)
+        result += static_cast<size_type>(std::popcount(block));
+      return result;
+    }
+
+    bool any() const noexcept {
+      block_type acc = 0;
+      for (block_type block : _blocks)
+        acc |= block;
+      return acc != 0;
+    }
+
+    bool none() const noexcept { return !any(); }
+    bool all() const noexcept { return count() == _size; }
+
+    dynamic_bitset& operator&=(const dynamic_bitset& other) noexcept {
+      size_type n = std::min(_blocks.size(), other._blocks.size());
+      block_type* lhs = _blocks.data();
+      const block_type* rhs = other._blocks.data();
+      for (size_type i = 0; i < n; ++i)
+        lhs[i] &= rhs[i];
+      std::fill(_blocks.begin() + n, _blocks.end(), block_type(0));
+      return *this;
+    }
+
+    dynamic_bitset& operator|=(const dynamic_bitset& other) noexcept {
+      size_type n = std::min(_blocks.size(), other._blocks.size());
+      block_type* lhs = _blocks.data();
+      const block_type* rhs = other._blocks.data();
+      for (size_type i = 0; i < n; ++i)
+        lhs[i] |= rhs[i];
+      _clear_tail();
+      return *this;
+    }
+
+    dynamic_bitset& operator^=(const dynamic_bitset& other) noexcept {
+      size_type n = std::min(_blocks.size(), other._blocks.size());
+      block_type* lhs = _blocks.data();
+      const block_type* rhs = other._blocks.data();
+      for (size_type i = 0; i < n; ++i)
+        lhs[i] ^= rhs[i];
+      _clear_tail();
+      return *this;
+    }
+
+    // *this &= ~other
+    dynamic_bitset& and_not(const dynamic_bitset& other) noexcept {
+      size_type n = std::min(_blocks.size(), other._blocks.size());
+      block_type* lhs = _blocks.data();
+      const block_type* rhs = other._blocks.data();
+      for (size_type i = 0; i < n; ++i)
+        lhs[i] &= ~rhs[i];
+      return *this;
+    }
+
+    dynamic_bitset& operator-=(const dynamic_bitset& other) noexcept {
+      return and_not(other);
+    }
+
+    friend dynamic_bitset operator&(dynamic_bitset lhs, const dynamic_bitset& rhs) { return lhs &= rhs; }
+    friend dynamic_bitset operator|(dynamic_bitset lhs, const dynamic_bitset& rhs) { return lhs |= rhs; }
+    friend dynamic_bitset operator^(dynamic_bitset lhs, const dynamic_bitset& rhs) { return lhs ^= rhs; }
+    friend dynamic_bitset operator-(dynamic_bitset lhs, const dynamic_bitset& rhs) { return lhs -= rhs; }
+
+    dynamic_bitset operator~() const {
+      dynamic_bitset result(*this);
+      return result.flip();
+    }
+
+    // popcount(*this & other) without materializing the intersection.
+    size_type and_count(const dynamic_bitset& other) const noexcept {
+      size_type n = std::min(_blocks.size(), other._blocks.size());
+      size_type result = 0;
+      for (size_type i = 0; i < n; ++i)
+        result += static_cast<size_type>(std::popcount(_blocks[i] & other._blocks[i]));
+      return result;
+    }
+
+    bool intersects(const dynamic_bitset& other) const noexcept {
+      size_type n = std::min(_blocks.size(), other._blocks.size());
+      for (size_type i = 0; i < n; ++i) {
+        if ((_blocks[i] & other._blocks[i]) != 0)
+          return true;
+      }
+      return false;
+    }
+
+    bool is_subset_of(const dynamic_bitset& other) const noexcept {
+      for (size_type i = 0; i < _blocks.size(); ++i) {
+        block_type rhs = i < other._blocks.size() ? other._blocks[i] : 0;
+        if ((_blocks[i] & ~rhs) != 0)
+          return false;
+      }
+      return true;
+    }
+
+    size_type find_first() const noexcept {
+      return find_next_from(0);
+    }
+
+    size_type find_next(size_type pos) const noexcept {
+      return find_next_from(pos + 1);
+    }
+
+    // First set bit at position >= pos, or npos.
+    size_type find_next_from(size_type pos) const noexcept {
+      if (pos >= _size)
+        return npos;
+
+      size_type i = pos / bits_per_block;
+      block_type block = _blocks[i] & ~(_mask(pos) - 1);
+      while (block == 0) {
+        if (++i == _blocks.size())
+          return npos;
+        block = _blocks[i];
+      }
+      return i * bits_per_block + static_cast<size_type>(std::countr_zero(block));
+    }
+
+    // Calls f(pos) for every set bit in increasing order.
+    template <typename F>
+    void for_each_set(F&& f) const {
+      for (size_type i = 0; i < _blocks.size(); ++i) {
+        for (block_type block = _blocks[i]; block != 0; block &= block - 1)
+          f(i * bits_per_block + static_cast<size_type>(std::countr_zero(block)));
+      }
+    }
+
+    friend bool operator==(const dynamic_bitset& lhs, const dynamic_bitset& rhs) noexcept {
+      return lhs._size == rhs._size && lhs._blocks == rhs._blocks;
+    }
+  };
+}
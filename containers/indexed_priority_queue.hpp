@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <functional> // std::less
+#include <stdexcept> // std::out_of_range, std::invalid_argument
+#include <utility> // std::move, std::swap
+#include <vector>
+
+#include "./d_ary_heap.hpp"
+
+namespace xlib::container {
+  // D-ary min-heap of ids in [0, n) with a priority per id. Knowing where every id sits in
+  // the heap makes decrease_key/update/erase O(log n), which Dijkstra and timer queues need.
+  // Ids don't have to be reserved up front: storage grows to the largest pushed id.
+  // top() is the id with the *smallest* priority with respect to Compare.
+  template <typename Priority, std::size_t D = 4, class Compare = std::less<Priority>>
+  class indexed_priority_queue {
+  public:
+    using id_type = std::size_t;
+    using priority_type = Priority;
+    using size_type = std::size_t;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+  private:
+    using layout = detail::d_ary_layout<D>;
+
+    std::vector<id_type> _heap;          // ids in heap order
+    std::vector<size_type> _position;    // _position[id] is the index in _heap, or npos
+    std::vector<Priority> _priority;     // _priority[id], valid while the id is queued
+
+    [[no_unique_address]] Compare _compare;
+
+    bool _less(size_type a, size_type b) const {
+      return _compare(_priority[_heap[a]], _priority[_heap[b]]);
+    }
+
+    void _place(size_type i, id_type id) noexcept {
+      _heap[i] = id;
+      _position[id] = i;
+    }
+
+    void _sift_up(size_type i) {
+      id_type id = _heap[i];
+      while (i != 0) {
+        size_type up = layout::parent(i);
+        if (!_compare(_priority[id], _priority[_heap[up]]))
+          break;
+        _place(i, _heap[up]);
+        i = up;
+      }
+      _place(i, id);
+    }
+
+    void _sift_down(size_type i) {
+      size_type size = _heap.size();
+      id_type id = _heap[i];
+      while (true) {
+        size_type first = layout::first_child(i);
+        if (first >= size)
+          break;
+
+        size_type last = first + D < size ? first + D : size;
+        size_type best = first;
+        for (size_type child = first + 1; child < last; ++child) {
+          if (_less(child, best))
+            best = child;
+        }
+
+        if (!_compare(_priority[_heap[best]], _priority[id]))
+          break;
+        _place(i, _heap[best]);
+        i = best;
+      }
+      _place(i, id);
+    }
+
+    void _remove_at(size_type i) {
+      id_type id = _heap[i];
+      id_type last = _heap.back();
+      _heap.pop_back();
+      _position[id] = npos;
+
+      if (i < _heap.size()) {
+        _place(i, last);
+        _sift_up(i);
+        _sift_down(_position[last]);
+      }
+    }
+
+  public:
+    indexed_priority_queue() = default;
+
+    explicit indexed_priority_queue(size_type max_id, const Compare& compare = {})
+        : _compare(compare) {
+      reserve(max_id);
+    }
+
+    bool empty() const noexcept { return _heap.empty(); }
+    size_type size() const noexcept { return _heap.size(); }
+
+    void reserve(size_type max_id) {
+      _heap.reserve(max_id);
+      if (_position.size() < max_id) {
+        _position.resize(max_id, npos);
+        _priority.resize(max_id);
+      }
+    }
+
+    bool contains(id_type id) const noexcept {
+      return id < _position.size() && _position[id] != npos;
+    }
+
+    const Priority& priority(id_type id) const {
+      if (!contains(id))
+        throw std::out_of_range("xlib::container::indexed_priority_queue::priority(): id isn't queued");
+      return _priority[id];
+    }
+
+    id_type top() const { return _heap.front(); }
+    const Priority& top_priority() const { return _priority[_heap.front()]; }
+
+    void push(id_type id, Priority priority) {
+      if (contains(id))
+        throw std::invalid_argument("xlib::container::indexed_priority_queue::push(): id is already queued");
+
+      if (id >= _position.size())
+        reserve(id + 1 > _position.size() * 2 ? id + 1 : _position.size() * 2);
+
+      _priority[id] = std::move(priority);
+      _heap.push_back(id);
+      _position[id] = _heap.size() - 1;
+      _sift_up(_heap.size() - 1);
+    }
+
+    id_type pop() {
+      id_type id = _heap.front();
+      _remove_at(0);
+      return id;
+    }
+
+    // Sets a priority which is not greater than the current one.
+    void decrease_key(id_type id, Priority priority) {
+      if (!contains(id))
+        throw std::out_of_range("xlib::container::indexed_priority_queue::decrease_key(): id isn't queued");
+      _priority[id] = std::move(priority);
+      _sift_up(_position[id]);
+    }
+
+    // Sets a priority which is not smaller than the current one.
+    void increase_key(id_type id, Priority priority) {
+      if (!contains(id))
+        throw std::out_of_range("xlib::container::indexed_priority_queue::increase_key(): id isn't queued");
+      _priority[id] = std::move(priority);
+      _sift_down(_position[id]);
+    }
+
+    // Sets any priority, pushing the id if it isn't queued yet.
+    void update(id_type id, Priority priority) {
+      if (!contains(id)) {
+        push(id, std::move(priority));
+        return;
+      }
+
+      bool up = _compare(priority, _priority[id]);
+      _priority[id] = std::move(priority);
+      if (up)
+        _sift_up(_position[id]);
+      else
+        _sift_down(_position[id]);
+    }
+
+    // Returns false if the id isn't queued.
+    bool erase(id_type id) {
+      if (!contains(id))
+        return false;
+      _remove_at(_position[id]);
+      return true;
+    }
+
+    void clear() noexcept {
+      for (id_type id : _heap)
+        _position[id] = npos;
+      _heap.clear();
+    }
+  };
+}
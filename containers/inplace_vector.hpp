@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm> // std::equal, std::lexicographical_compare, std::rotate
+#include <compare> // std::strong_ordering
+#include <cstddef> // std::size_t, std::ptrdiff_t, std::byte
+#include <initializer_list>
+#include <iterator> // std::reverse_iterator, std::distance
+#include <memory> // std::uninitialized_*, std::destroy
+#include <new> // std::bad_alloc
+#include <stdexcept> // std::out_of_range
+#include <type_traits>
+#include <utility> // std::move, std::forward, std::swap
+
+namespace xlib::container {
+  // Vector with fixed capacity N and storage inside the object. It never touches the heap:
+  // growing beyond N throws std::bad_alloc (try_* functions return nullptr instead).
+  template <typename T, std::size_t N>
+  class inplace_vector {
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  private:
+    alignas(T) std::byte _storage[sizeof(T) * (N == 0 ? 1 : N)];
+    size_type _size = 0;
+
+    pointer _ptr(size_type i) noexcept {
+      return reinterpret_cast<pointer>(_storage) + i;
+    }
+
+    const_pointer _ptr(size_type i) const noexcept {
+      return reinterpret_cast<const_pointer>(_storage) + i;
+    }
+
+    void _check_capacity(size_type count) const {
+      if (count > N)
+        throw std::bad_alloc();
+    }
+
+  public:
+    inplace_vector() noexcept = default;
+
+    explicit inplace_vector(size_type count) {
+      resize(count);
+    }
+
+    inplace_vector(size_type count, const T& value) {
+      assign(count, value);
+    }
+
+    template <typename InputIt>
+    requires (!std::is_integral_v<InputIt>)
+    inplace_vector(InputIt first, InputIt last) {
+      assign(first, last);
+    }
+
+    inplace_vector(std::initializer_list<T> list) {
+      assign(list.begin(), list.end());
+    }
+
+    inplace_vector(const inplace_vector& other) {
+      std::uninitialized_copy(other.begin(), other.end(), begin());
+      _size = other._size;
+    }
+
+    inplace_vector(inplace_vector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+      std::uninitialized_move(other.begin(), other.end(), begin());
+      _size = other._size;
+      other.clear();
+    }
+
+    ~inplace_vector() {
+      clear();
+    }
+
+    inplace_vector& operator=(const inplace_vector& other) {
+      if (this != &other)
+        assign(other.begin(), other.end());
+      return *this;
+    }
+
+    inplace_vector& operator=(inplace_vector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+      if (this != &other) {
+        clear();
+        std::uninitialized_move(other.begin(), other.end(), begin());
+        _size = other._size;
+        other.clear();
+      }
+      return *this;
+    }
+
+    inplace_vector& operator=(std::initializer_list<T> list) {
+      assign(list.begin(), list.end());
+      return *this;
+    }
+
+    void assign(size_type count, const T& value) {
+      _check_capacity(count);
+      clear();
+      std::uninitialized_fill_n(begin(), count, value);
+      _size = count;
+    }
+
+    template <typename InputIt>
+    requires (!std::is_integral_v<InputIt>)
+    void assign(InputIt first, InputIt last) {
+      clear();
+      for (; first != last; ++first)
+        emplace_back(*first);
+    }
+
+    iterator begin() noexcept { return _ptr(0); }
+    const_iterator begin() const noexcept { return _ptr(0); }
+    const_iterator cbegin() const noexcept { return _ptr(0); }
+
+    iterator end() noexcept { return _ptr(_size); }
+    const_iterator end() const noexcept { return _ptr(_size); }
+    const_iterator cend() const noexcept { return _ptr(_size); }
+
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    bool empty() const noexcept { return _size == 0; }
+    size_type size() const noexcept { return _size; }
+    static constexpr size_type max_size() noexcept { return N; }
+    static constexpr size_type capacity() noexcept { return N; }
+
+    pointer data() noexcept { return _ptr(0); }
+    const_pointer data() const noexcept { return _ptr(0); }
+
+    reference operator[](size_type i) { return *_ptr(i); }
+    const_reference operator[](size_type i) const { return *_ptr(i); }
+
+    reference at(size_type i) {
+      if (i >= _size)
+        throw std::out_of_range("xlib::container::inplace_vector::at(): index out of range");
+      return *_ptr(i);
+    }
+
+    const_reference at(size_type i) const {
+      if (i >= _size)
+        throw std::out_of_range("xlib::container::inplace_vector::at(): index out of range");
+      return *_ptr(i);
+    }
+
+    reference front() { return *_ptr(0); }
+    const_reference front() const { return *_ptr(0); }
+    reference back() { return *_ptr(_size - 1); }
+    const_reference back() const { return *_ptr(_size - 1); }
+
+    template <typename... Args>
+    pointer try_emplace_back(Args&&... args) {
+      if (_size == N)
+        return nullptr;
+      return &unchecked_emplace_back(std::forward<Args>(args)...);
+    }
+
+    pointer try_push_back(const T& value) { return try_emplace_back(value); }
+    pointer try_push_back(T&& value) { return try_emplace_back(std::move(value)); }
+
+    template <typename... Args>
+    reference unchecked_emplace_back(Args&&... args) {
+      pointer ptr = std::construct_at(_ptr(_size), std::forward<Args>(args)...);
+      ++_size;
+      return *ptr;
+    }
+
+    template <typename... Args>
+    reference emplace_back(Args&&... args) {
+      _check_capacity(_size + 1);
+      return unchecked_emplace_back(std::forward<Args>(args)...);
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_back() {
+      --_size;
+      std::destroy_at(_ptr(_size));
+    }
+
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args&&... args) {
+      size_type index = pos - begin();
+      emplace_back(std::forward<Args>(args)...);
+      std::rotate(begin() + index, end() - 1, end());
+      return begin() + index;
+    }
+
+    iterator insert(const_iterator pos, const T& value) { return emplace(pos, value); }
+    iterator insert(const_iterator pos, T&& value) { return emplace(pos, std::move(value)); }
+
+    template <typename InputIt>
+    requires (!std::is_integral_v<InputIt>)
+    iterator insert(const_iterator pos, InputIt first, InputIt last) {
+      size_type index = pos - begin();
+      size_type old_size = _size;
+      for (; first != last; ++first)
+        emplace_back(*first);
+      std::rotate(begin() + index, begin() + old_size, end());
+      return begin() + index;
+    }
+
+    iterator insert(const_iterator pos, std::initializer_list<T> list) {
+      return insert(pos, list.begin(), list.end());
+    }
+
+    iterator erase(const_iterator pos) {
+      return erase(pos, pos + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+      iterator f = begin() + (first - begin());
+      iterator l = begin() + (last - begin());
+      if (f != l) {
+        iterator new_end = std::move(l, end(), f);
+        std::destroy(new_end, end());
+        _size = new_end - begin();
+      }
+      return f;
+    }
+
+    void resize(size_type count) {
+      _check_capacity(count);
+      if (count < _size) {
+        std::destroy(begin() + count, end());
+      }
+      else {
+        std::uninitialized_value_construct(end(), begin() + count);
+      }
+      _size = count;
+    }
+
+    void resize(size_type count, const T& value) {
+      _check_capacity(count);
+      if (count < _size) {
+        std::destroy(begin() + count, end());
+      }
+      else {
+        std::uninitialized_fill(end(), begin() + count, value);
+      }
+      _size = count;
+    }
+
+    static void reserve(size_type count) {
+      if (count > N)
+        throw std::bad_alloc();
+    }
+
+    static void shrink_to_fit() noexcept {}
+
+    void clear() noexcept {
+      std::destroy(begin(), end());
+      _size = 0;
+    }
+
+    void swap(inplace_vector& other) {
+      inplace_vector tmp(std::move(other));
+      other = std::move(*this);
+      *this = std::move(tmp);
+    }
+
+    friend void swap(inplace_vector& lhs, inplace_vector& rhs) {
+      lhs.swap(rhs);
+    }
+
+    friend bool operator==(const inplace_vector& lhs, const inplace_vector& rhs) {
+      return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+    friend auto operator<=>(const inplace_vector& lhs, const inplace_vector& rhs) {
+      return std::lexicographical_compare_three_way(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+  };
+}
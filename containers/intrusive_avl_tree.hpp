@@ -0,0 +1,383 @@
+#pragma once
+
+#include <algorithm> // std::max
+#include <cassert>
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <functional> // std::less
+#include <iterator> // std::bidirectional_iterator_tag
+#include <type_traits> // std::conditional_t
+#include <utility> // std::pair
+
+namespace xlib::container {
+  // Base class for objects which may be linked into intrusive_avl_tree<T, Compare, Tag>.
+  // Unlike the list and hash set hooks it can't unlink itself: removing a node rebalances the
+  // tree and may change its root, which only the tree knows. Erase an element before it dies
+  // (checked in debug builds).
+  template <typename Tag = void>
+  class intrusive_avl_tree_hook {
+    template <typename, typename, typename>
+    friend class intrusive_avl_tree;
+
+  private:
+    intrusive_avl_tree_hook* _left = nullptr;
+    intrusive_avl_tree_hook* _right = nullptr;
+    intrusive_avl_tree_hook* _up = nullptr;
+    int _height = 0; // 0 means "not linked", leaves have height 1
+
+  public:
+    intrusive_avl_tree_hook() noexcept = default;
+
+    intrusive_avl_tree_hook(const intrusive_avl_tree_hook&) noexcept {}
+    intrusive_avl_tree_hook& operator=(const intrusive_avl_tree_hook&) noexcept { return *this; }
+
+    ~intrusive_avl_tree_hook() {
+      assert(!is_linked() && "xlib::container::intrusive_avl_tree_hook: destroyed while still in a tree");
+    }
+
+    bool is_linked() const noexcept {
+      return _height != 0;
+    }
+  };
+
+  // Balanced ordered set over objects derived from intrusive_avl_tree_hook<Tag>.
+  // Never allocates and doesn't own its elements; erase by reference is O(log n)
+  // without any lookup.
+  template <typename T, class Compare = std::less<T>, typename Tag = void>
+  class intrusive_avl_tree {
+  public:
+    using value_type = T;
+    using hook_type = intrusive_avl_tree_hook<Tag>;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+
+  private:
+    using node_t = hook_type;
+
+    node_t* _root = nullptr;
+    size_type _size = 0;
+
+    [[no_unique_address]] Compare _compare;
+
+    static T& _to_value(node_t* node) noexcept {
+      return static_cast<T&>(*node);
+    }
+
+    static node_t* _to_node(T& value) noexcept {
+      return static_cast<node_t*>(&value);
+    }
+
+    static int _height(node_t* node) noexcept {
+      return node == nullptr ? 0 : node->_height;
+    }
+
+    static void _update_height(node_t* node) noexcept {
+      node->_height = std::max(_height(node->_left), _height(node->_right)) + 1;
+    }
+
+    static node_t* _min(node_t* node) noexcept {
+      while (node->_left != nullptr)
+        node = node->_left;
+      return node;
+    }
+
+    static node_t* _max(node_t* node) noexcept {
+      while (node->_right != nullptr)
+        node = node->_right;
+      return node;
+    }
+
+    static node_t* _next(node_t* node) noexcept {
+      if (node->_right != nullptr)
+        return _min(node->_right);
+
+      while (node->_up != nullptr && node->_up->_right == node)
+        node = node->_up;
+      return node->_up;
+    }
+
+    static node_t* _prev(node_t* node) noexcept {
+      if (node->_left != nullptr)
+        return _max(node->_left);
+
+      while (node->_up != nullptr && node->_up->_left == node)
+        node = node->_up;
+      return node->_up;
+    }
+
+    void _replace_child(node_t* up, node_t* old_child, node_t* new_child) noexcept {
+      if (up == nullptr)
+        _root = new_child;
+      else if (up->_left == old_child)
+        up->_left = new_child;
+      else
+        up->_right = new_child;
+    }
+
+    node_t* _rotate_left(node_t* x) noexcept {
+      node_t* y = x->_right;
+      x->_right = y->_left;
+      if (y->_left != nullptr)
+        y->_left->_up = x;
+      y->_up = x->_up;
+      _replace_child(x->_up, x, y);
+      y->_left = x;
+      x->_up = y;
+      _update_height(x);
+      _update_height(y);
+      return y;
+    }
+
+    node_t* _rotate_right(node_t* x) noexcept {
+      node_t* y = x->_left;
+      x->_left = y->_right;
+      if (y->_right != nullptr)
+        y->_right->_up = x;
+      y->_up = x->_up;
+      _replace_child(x->_up, x, y);
+      y->_right = x;
+      x->_up = y;
+      _update_height(x);
+      _update_height(y);
+      return y;
+    }
+
+    void _rebalance_from(node_t* node) noexcept {
+      while (node != nullptr) {
+        _update_height(node);
+        int balance = _height(node->_left) - _height(node->_right);
+
+        if (balance > 1) {
+          if (_height(node->_left->_left) < _height(node->_left->_right))
+            _rotate_left(node->_left);
+          node = _rotate_right(node);
+        }
+        else if (balance < -1) {
+          if (_height(node->_right->_right) < _height(node->_right->_left))
+            _rotate_right(node->_right);
+          node = _rotate_left(node);
+        }
+
+        node = node->_up;
+      }
+    }
+
+    static void _reset(node_t* node) noexcept {
+      node->_left = node->_right = node->_up = nullptr;
+      node->_height = 0;
+    }
+
+    void _reset_subtree(node_t* node) noexcept {
+      while (node != nullptr) {
+        _reset_subtree(node->_left);
+        node_t* right = node->_right;
+        _reset(node);
+        node = right;
+      }
+    }
+
+    template <bool is_const>
+    class _base_iterator {
+      friend class intrusive_avl_tree<T, Compare, Tag>;
+      template <bool>
+      friend class _base_iterator;
+    private:
+      node_t* _ptr = nullptr;
+      const intrusive_avl_tree* _tree = nullptr;
+
+      _base_iterator(node_t* ptr, const intrusive_avl_tree* tree) noexcept : _ptr(ptr), _tree(tree) {}
+
+    public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = std::conditional_t<is_const, const T*, T*>;
+      using reference = std::conditional_t<is_const, const T&, T&>;
+
+      _base_iterator() noexcept = default;
+
+      template <bool other_const>
+      requires (is_const && !other_const)
+      _base_iterator(const _base_iterator<other_const>& other) noexcept : _ptr(other._ptr), _tree(other._tree) {}
+
+      reference operator*() const noexcept { return _to_value(_ptr); }
+      pointer operator->() const noexcept { return &_to_value(_ptr); }
+
+      _base_iterator& operator++() noexcept {
+        _ptr = _next(_ptr);
+        return *this;
+      }
+
+      _base_iterator& operator--() noexcept {
+        _ptr = (_ptr == nullptr) ? _max(_tree->_root) : _prev(_ptr);
+        return *this;
+      }
+
+      _base_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+      _base_iterator operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+
+      bool operator==(const _base_iterator& other) const noexcept { return _ptr == other._ptr; }
+    };
+
+  public:
+    using iterator = _base_iterator<false>;
+    using const_iterator = _base_iterator<true>;
+
+    explicit intrusive_avl_tree(const Compare& compare = {}) : _compare(compare) {}
+
+    intrusive_avl_tree(const intrusive_avl_tree&) = delete;
+    intrusive_avl_tree& operator=(const intrusive_avl_tree&) = delete;
+
+    ~intrusive_avl_tree() {
+      clear();
+    }
+
+    iterator begin() noexcept { return {_root == nullptr ? nullptr : _min(_root), this}; }
+    const_iterator begin() const noexcept { return {_root == nullptr ? nullptr : _min(_root), this}; }
+    iterator end() noexcept { return {nullptr, this}; }
+    const_iterator end() const noexcept { return {nullptr, this}; }
+
+    bool empty() const noexcept { return _size == 0; }
+    size_type size() const noexcept { return _size; }
+    int height() const noexcept { return _height(_root); }
+
+    iterator iterator_to(T& value) noexcept {
+      return {_to_node(value), this};
+    }
+
+    // value must not be in another tree with the same Tag (checked in debug builds).
+    std::pair<iterator, bool> insert(T& value) {
+      assert(!_to_node(value)->is_linked() && "xlib::container::intrusive_avl_tree::insert(): value is already in a tree");
+
+      node_t* up = nullptr;
+      node_t** link = &_root;
+
+      while (*link != nullptr) {
+        up = *link;
+        if (_compare(value, _to_value(up)))
+          link = &up->_left;
+        else if (_compare(_to_value(up), value))
+          link = &up->_right;
+        else
+          return {{up, this}, false};
+      }
+
+      node_t* node = _to_node(value);
+      node->_left = node->_right = nullptr;
+      node->_up = up;
+      node->_height = 1;
+      *link = node;
+      ++_size;
+
+      _rebalance_from(up);
+
+      return {{node, this}, true};
+    }
+
+    template <typename K>
+    iterator lower_bound(const K& key) {
+      node_t* result = nullptr;
+      for (node_t* it = _root; it != nullptr;) {
+        if (_compare(_to_value(it), key)) {
+          it = it->_right;
+        }
+        else {
+          result = it;
+          it = it->_left;
+        }
+      }
+      return {result, this};
+    }
+
+    template <typename K>
+    iterator upper_bound(const K& key) {
+      node_t* result = nullptr;
+      for (node_t* it = _root; it != nullptr;) {
+        if (_compare(key, _to_value(it))) {
+          result = it;
+          it = it->_left;
+        }
+        else {
+          it = it->_right;
+        }
+      }
+      return {result, this};
+    }
+
+    template <typename K>
+    iterator find(const K& key) {
+      iterator it = lower_bound(key);
+      if (it != end() && !_compare(key, *it))
+        return it;
+      return end();
+    }
+
+    template <typename K>
+    bool contains(const K& key) {
+      return find(key) != end();
+    }
+
+    void erase(T& value) noexcept {
+      node_t* node = _to_node(value);
+      node_t* rebalance_start;
+
+      if (node->_left == nullptr || node->_right == nullptr) {
+        node_t* child = (node->_left != nullptr) ? node->_left : node->_right;
+        if (child != nullptr)
+          child->_up = node->_up;
+        _replace_child(node->_up, node, child);
+        rebalance_start = node->_up;
+      }
+      else {
+        node_t* successor = _min(node->_right);
+
+        if (successor->_up != node) {
+          rebalance_start = successor->_up;
+          rebalance_start->_left = successor->_right;
+          if (successor->_right != nullptr)
+            successor->_right->_up = rebalance_start;
+          successor->_right = node->_right;
+          node->_right->_up = successor;
+        }
+        else {
+          rebalance_start = successor;
+        }
+
+        successor->_left = node->_left;
+        node->_left->_up = successor;
+        successor->_up = node->_up;
+        successor->_height = node->_height;
+        _replace_child(node->_up, node, successor);
+      }
+
+      _reset(node);
+      --_size;
+
+      _rebalance_from(rebalance_start);
+    }
+
+    iterator erase(const_iterator pos) noexcept {
+      iterator next(_next(pos._ptr), this);
+      erase(_to_value(pos._ptr));
+      return next;
+    }
+
+    iterator erase(iterator pos) noexcept {
+      return erase(const_iterator(pos));
+    }
+
+    template <typename K>
+    size_type erase(const K& key) {
+      iterator it = find(key);
+      if (it == end())
+        return 0;
+      erase(*it);
+      return 1;
+    }
+
+    void clear() noexcept {
+      _reset_subtree(_root);
+      _root = nullptr;
+      _size = 0;
+    }
+  };
+}
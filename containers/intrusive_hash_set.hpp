@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm> // std::max
+#include <bit> // std::bit_ceil
+#include <cmath> // std::ceil
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <functional> // std::hash, std::equal_to
+#include <iterator> // std::forward_iterator_tag
+#include <memory> // std::allocator, std::allocator_traits
+#include <type_traits> // std::conditional_t
+#include <utility> // std::pair
+
+namespace xlib::container {
+  // Base class for objects which may be linked into intrusive_hash_set<T, ..., Tag>.
+  // The hook caches the hash, so rehashing never calls Hash again. Like intrusive_list_hook
+  // it unlinks itself on destruction, so an element may die while still in a set.
+  template <typename Tag = void>
+  class intrusive_hash_set_hook {
+    template <typename, typename, typename, typename, typename>
+    friend class intrusive_hash_set;
+
+  private:
+    intrusive_hash_set_hook* _next = nullptr;
+    intrusive_hash_set_hook** _pprev = nullptr;
+    std::size_t* _set_size = nullptr;
+    std::size_t _hash = 0;
+
+    void _link(intrusive_hash_set_hook*& bucket) noexcept {
+      _next = bucket;
+      if (bucket != nullptr)
+        bucket->_pprev = &_next;
+      bucket = this;
+      _pprev = &bucket;
+    }
+
+    void _detach() noexcept {
+      *_pprev = _next;
+      if (_next != nullptr)
+        _next->_pprev = _pprev;
+      _next = nullptr;
+      _pprev = nullptr;
+    }
+
+  public:
+    intrusive_hash_set_hook() noexcept = default;
+
+    intrusive_hash_set_hook(const intrusive_hash_set_hook&) noexcept {}
+    intrusive_hash_set_hook& operator=(const intrusive_hash_set_hook&) noexcept { return *this; }
+
+    ~intrusive_hash_set_hook() {
+      unlink();
+    }
+
+    bool is_linked() const noexcept {
+      return _pprev != nullptr;
+    }
+
+    // O(1), doesn't need the set object.
+    void unlink() noexcept {
+      if (!is_linked())
+        return;
+
+      --*_set_size;
+      _detach();
+    }
+  };
+
+  // Hash set over objects derived from intrusive_hash_set_hook<Tag>. Elements are not owned
+  // and not copied; insert and erase never allocate, only growing the bucket array does
+  // (call reserve() up front to avoid it). Erase by reference is O(1).
+  template <
+      typename T,
+      class Hash = std::hash<T>,
+      class KeyEqual = std::equal_to<T>,
+      typename Tag = void,
+      class Allocator = std::allocator<intrusive_hash_set_hook<Tag>*>
+  >
+  class intrusive_hash_set {
+  public:
+    using value_type = T;
+    using hook_type = intrusive_hash_set_hook<Tag>;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+
+  private:
+    using bucket_t = hook_type*;
+    using ATR = std::allocator_traits<Allocator>;
+
+    bucket_t* _buckets = nullptr;
+    size_type _bucket_count = 0;
+    size_type _size = 0;
+    float _max_load_factor = 1.0f;
+
+    [[no_unique_address]] Hash _hash_function;
+    [[no_unique_address]] KeyEqual _key_equal;
+    [[no_unique_address]] Allocator _allocator;
+
+    static T& _to_value(hook_type* hook) noexcept {
+      return static_cast<T&>(*hook);
+    }
+
+    static hook_type* _to_hook(T& value) noexcept {
+      return static_cast<hook_type*>(&value);
+    }
+
+    size_type _index(std::size_t hash) const noexcept {
+      return hash & (_bucket_count - 1);
+    }
+
+    template <typename K>
+    hook_type* _find(const K& key, std::size_t hash) const {
+      if (_bucket_count == 0)
+        return nullptr;
+
+      for (hook_type* it = _buckets[_index(hash)]; it != nullptr; it = it->_next) {
+        if (it->_hash == hash && _key_equal(_to_value(it), key))
+          return it;
+      }
+      return nullptr;
+    }
+
+    template <bool is_const>
+    class _base_iterator {
+      friend class intrusive_hash_set<T, Hash, KeyEqual, Tag, Allocator>;
+      template <bool>
+      friend class _base_iterator;
+    private:
+      hook_type* _ptr = nullptr;
+      const intrusive_hash_set* _set = nullptr;
+
+      _base_iterator(hook_type* ptr, const intrusive_hash_set* set) noexcept : _ptr(ptr), _set(set) {}
+
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = std::conditional_t<is_const, const T*, T*>;
+      using reference = std::conditional_t<is_const, const T&, T&>;
+
+      _base_iterator() noexcept = default;
+
+      template <bool other_const>
+      requires (is_const && !other_const)
+      _base_iterator(const _base_iterator<other_const>& other) noexcept : _ptr(other._ptr), _set(other._set) {}
+
+      reference operator*() const noexcept { return _to_value(_ptr); }
+      pointer operator->() const noexcept { return &_to_value(_ptr); }
+
+      _base_iterator& operator++() noexcept {
+        if (_ptr->_next != nullptr) {
+          _ptr = _ptr->_next;
+        }
+        else {
+          size_type i = _set->_index(_ptr->_hash) + 1;
+          while (i < _set->_bucket_count && _set->_buckets[i] == nullptr)
+            ++i;
+          _ptr = (i < _set->_bucket_count) ? _set->_buckets[i] : nullptr;
+        }
+        return *this;
+      }
+
+      _base_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+
+      bool operator==(const _base_iterator& other) const noexcept { return _ptr == other._ptr; }
+    };
+
+  public:
+    using iterator = _base_iterator<false>;
+    using const_iterator = _base_iterator<true>;
+
+    explicit intrusive_hash_set(
+        size_type bucket_count = 64,
+        const Hash& hash_function = {},
+        const KeyEqual& key_equal = {},
+        const Allocator& allocator = {})
+        : _hash_function(hash_function)
+        , _key_equal(key_equal)
+        , _allocator(allocator) {
+      rehash(bucket_count);
+    }
+
+    intrusive_hash_set(const intrusive_hash_set&) = delete;
+    intrusive_hash_set& operator=(const intrusive_hash_set&) = delete;
+
+    ~intrusive_hash_set() {
+      clear();
+      if (_buckets != nullptr)
+        ATR::deallocate(_allocator, _buckets, _bucket_count);
+    }
+
+    iterator begin() noexcept {
+      for (size_type i = 0; i < _bucket_count; ++i) {
+        if (_buckets[i] != nullptr)
+          return {_buckets[i], this};
+      }
+      return end();
+    }
+
+    const_iterator begin() const noexcept { return const_cast<intrusive_hash_set*>(this)->begin(); }
+    iterator end() noexcept { return {nullptr, this}; }
+    const_iterator end() const noexcept { return {nullptr, this}; }
+
+    bool empty() const noexcept { return _size == 0; }
+    size_type size() const noexcept { return _size; }
+    size_type bucket_count() const noexcept { return _bucket_count; }
+
+    float load_factor() const noexcept {
+      return static_cast<float>(_size) / static_cast<float>(_bucket_count);
+    }
+
+    float max_load_factor() const noexcept { return _max_load_factor; }
+    void max_load_factor(float max_lf) noexcept { _max_load_factor = max_lf; }
+
+    iterator iterator_to(T& value) noexcept {
+      return {_to_hook(value), this};
+    }
+
+    // A value which is still in another set with the same Tag is moved out of it.
+    std::pair<iterator, bool> insert(T& value) {
+      std::size_t hash = _hash_function(value);
+      if (hook_type* found = _find(value, hash); found != nullptr)
+        return {{found, this}, false};
+
+      _to_hook(value)->unlink();
+
+      if (static_cast<float>(_size + 1) > _max_load_factor * static_cast<float>(_bucket_count))
+        rehash(_bucket_count * 2);
+
+      hook_type* hook = _to_hook(value);
+      hook->_hash = hash;
+      hook->_set_size = &_size;
+      hook->_link(_buckets[_index(hash)]);
+      ++_size;
+
+      return {{hook, this}, true};
+    }
+
+    template <typename K>
+    iterator find(const K& key) {
+      return {_find(key, _hash_function(key)), this};
+    }
+
+    template <typename K>
+    const_iterator find(const K& key) const {
+      return {_find(key, _hash_function(key)), this};
+    }
+
+    template <typename K>
+    bool contains(const K& key) const {
+      return _find(key, _hash_function(key)) != nullptr;
+    }
+
+    void erase(T& value) noexcept {
+      _to_hook(value)->unlink();
+    }
+
+    iterator erase(const_iterator pos) noexcept {
+      iterator next(pos._ptr, this);
+      ++next;
+      erase(_to_value(pos._ptr));
+      return next;
+    }
+
+    iterator erase(iterator pos) noexcept {
+      return erase(const_iterator(pos));
+    }
+
+    template <typename K>
+    size_type erase(const K& key) {
+      hook_type* found = _find(key, _hash_function(key));
+      if (found == nullptr)
+        return 0;
+      erase(_to_value(found));
+      return 1;
+    }
+
+    void clear() noexcept {
+      for (size_type i = 0; i < _bucket_count; ++i) {
+        while (_buckets[i] != nullptr)
+          _buckets[i]->_detach();
+      }
+      _size = 0;
+    }
+
+    // Never shrinks below what the current size needs under max_load_factor().
+    void rehash(size_type count) {
+      auto needed = static_cast<size_type>(std::ceil(static_cast<float>(_size) / _max_load_factor));
+      count = std::bit_ceil(std::max<size_type>({count, needed, 1}));
+      if (count == _bucket_count)
+        return;
+
+      bucket_t* new_buckets = ATR::allocate(_allocator, count);
+      for (size_type i = 0; i < count; ++i)
+        new_buckets[i] = nullptr;
+
+      bucket_t* old_buckets = _buckets;
+      size_type old_bucket_count = _bucket_count;
+      _buckets = new_buckets;
+      _bucket_count = count;
+
+      for (size_type i = 0; i < old_bucket_count; ++i) {
+        while (old_buckets[i] != nullptr) {
+          hook_type* hook = old_buckets[i];
+          hook->_detach();
+          hook->_link(_buckets[_index(hook->_hash)]);
+        }
+      }
+
+      if (old_buckets != nullptr)
+        ATR::deallocate(_allocator, old_buckets, old_bucket_count);
+    }
+
+    void reserve(size_type count) {
+      rehash(static_cast<size_type>(static_cast<float>(count) / _max_load_factor) + 1);
+    }
+  };
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <iterator> // std::bidirectional_iterator_tag
+#include <type_traits> // std::conditional_t
+
+namespace xlib::container {
+  // Base class for objects which may be linked into intrusive_list<T, Tag>.
+  // Use different Tag types to put the same object into several lists at once.
+  template <typename Tag = void>
+  class intrusive_list_hook {
+    template <typename, typename>
+    friend class intrusive_list;
+
+  private:
+    intrusive_list_hook* _prev = nullptr;
+    intrusive_list_hook* _next = nullptr;
+
+    void _link_before(intrusive_list_hook* pos) noexcept {
+      _next = pos;
+      _prev = pos->_prev;
+      _prev->_next = this;
+      pos->_prev = this;
+    }
+
+  public:
+    intrusive_list_hook() noexcept = default;
+
+    intrusive_list_hook(const intrusive_list_hook&) noexcept {}
+    intrusive_list_hook& operator=(const intrusive_list_hook&) noexcept { return *this; }
+
+    ~intrusive_list_hook() {
+      unlink();
+    }
+
+    bool is_linked() const noexcept {
+      return _next != nullptr;
+    }
+
+    // O(1), doesn't need the list object.
+    void unlink() noexcept {
+      if (!is_linked())
+        return;
+
+      _prev->_next = _next;
+      _next->_prev = _prev;
+      _prev = _next = nullptr;
+    }
+  };
+
+  // Doubly linked circular list over objects derived from intrusive_list_hook<Tag>.
+  // The list never allocates and doesn't own its elements; size() is O(n) because
+  // elements can unlink themselves without the list.
+  template <typename T, typename Tag = void>
+  class intrusive_list {
+  public:
+    using value_type = T;
+    using hook_type = intrusive_list_hook<Tag>;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+
+  private:
+    hook_type _root;
+
+    static T& _to_value(hook_type* hook) noexcept {
+      return static_cast<T&>(*hook);
+    }
+
+    static hook_type* _to_hook(T& value) noexcept {
+      return static_cast<hook_type*>(&value);
+    }
+
+    void _init() noexcept {
+      _root._prev = _root._next = &_root;
+    }
+
+    template <bool is_const>
+    class _base_iterator {
+      friend class intrusive_list<T, Tag>;
+      template <bool>
+      friend class _base_iterator;
+    private:
+      hook_type* _ptr = nullptr;
+
+      explicit _base_iterator(hook_type* ptr) noexcept : _ptr(ptr) {}
+
+    public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = std::conditional_t<is_const, const T*, T*>;
+      using reference = std::conditional_t<is_const, const T&, T&>;
+
+      _base_iterator() noexcept = default;
+
+      template <bool other_const>
+      requires (is_const && !other_const)
+      _base_iterator(const _base_iterator<other_const>& other) noexcept : _ptr(other._ptr) {}
+
+      reference operator*() const noexcept { return _to_value(_ptr); }
+      pointer operator->() const noexcept { return &_to_value(_ptr); }
+
+      _base_iterator& operator++() noexcept { _ptr = _ptr->_next; return *this; }
+      _base_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+      _base_iterator& operator--() noexcept { _ptr = _ptr->_prev; return *this; }
+      _base_iterator operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+
+      bool operator==(const _base_iterator& other) const noexcept { return _ptr == other._ptr; }
+    };
+
+  public:
+    using iterator = _base_iterator<false>;
+    using const_iterator = _base_iterator<true>;
+
+    intrusive_list() noexcept {
+      _init();
+    }
+
+    intrusive_list(const intrusive_list&) = delete;
+    intrusive_list& operator=(const intrusive_list&) = delete;
+
+    intrusive_list(intrusive_list&& other) noexcept {
+      _init();
+      splice(end(), other);
+    }
+
+    intrusive_list& operator=(intrusive_list&& other) noexcept {
+      if (this != &other) {
+        clear();
+        splice(end(), other);
+      }
+      return *this;
+    }
+
+    ~intrusive_list() {
+      clear();
+      _root._prev = _root._next = nullptr;
+    }
+
+    iterator begin() noexcept { return iterator(_root._next); }
+    const_iterator begin() const noexcept { return const_iterator(_root._next); }
+    iterator end() noexcept { return iterator(&_root); }
+    const_iterator end() const noexcept { return const_iterator(const_cast<hook_type*>(&_root)); }
+
+    bool empty() const noexcept { return _root._next == &_root; }
+
+    size_type size() const noexcept {
+      size_type count = 0;
+      for (auto* it = _root._next; it != &_root; it = it->_next)
+        ++count;
+      return count;
+    }
+
+    T& front() noexcept { return _to_value(_root._next); }
+    T& back() noexcept { return _to_value(_root._prev); }
+
+    static iterator iterator_to(T& value) noexcept {
+      return iterator(_to_hook(value));
+    }
+
+    // value may already be linked (here or elsewhere); it is moved to pos.
+    iterator insert(const_iterator pos, T& value) noexcept {
+      hook_type* hook = _to_hook(value);
+      if (hook == pos._ptr)
+        return iterator(hook);
+
+      hook->unlink();
+      hook->_link_before(pos._ptr);
+      return iterator(hook);
+    }
+
+    void push_front(T& value) noexcept { insert(begin(), value); }
+    void push_back(T& value) noexcept { insert(end(), value); }
+
+    void pop_front() noexcept { _root._next->unlink(); }
+    void pop_back() noexcept { _root._prev->unlink(); }
+
+    iterator erase(const_iterator pos) noexcept {
+      hook_type* next = pos._ptr->_next;
+      pos._ptr->unlink();
+      return iterator(next);
+    }
+
+    static void erase(T& value) noexcept {
+      _to_hook(value)->unlink();
+    }
+
+    // Moves all elements of other before pos.
+    void splice(const_iterator pos, intrusive_list& other) noexcept {
+      if (other.empty())
+        return;
+
+      hook_type* first = other._root._next;
+      hook_type* last = other._root._prev;
+      other._init();
+
+      first->_prev = pos._ptr->_prev;
+      first->_prev->_next = first;
+      last->_next = pos._ptr;
+      pos._ptr->_prev = last;
+    }
+
+    void clear() noexcept {
+      while (!empty())
+        pop_front();
+    }
+  };
+}
@@ -0,0 +1,551 @@
+#pragma once
+
+#include <algorithm> // std::lower_bound, std::set_*, std::any_of, std::all_of
+#include <bit> // std::popcount, std::countr_zero
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <cstdint> // std::int32_t, std::uint16_t, std::uint32_t, std::uint64_t
+#include <initializer_list>
+#include <iterator> // std::back_inserter, std::forward_iterator_tag
+#include <utility> // std::move
+#include <vector>
+
+namespace xlib::container {
+  namespace detail {
+    // Set of the low 16 bits of values which share the same high 16 bits. Sparse
+    // containers are a sorted array, dense ones (more than 4096 values) a 65536-bit bitmap,
+    // so a container never takes more than 8 KiB. A bitmap only turns back into an array
+    // at min_bitmap_size, so add/remove around 4096 doesn't convert on every call.
+    class roaring_container {
+    public:
+      static constexpr std::size_t max_array_size = 4096;
+      static constexpr std::size_t min_bitmap_size = max_array_size / 2;
+      static constexpr std::size_t bitmap_words = 65536 / 64;
+
+    private:
+      std::uint16_t _key = 0;
+      std::uint32_t _cardinality = 0;
+      std::vector<std::uint16_t> _array;  // used while !is_bitmap()
+      std::vector<std::uint64_t> _bitmap; // bitmap_words words when is_bitmap()
+
+      static std::uint64_t _mask(std::uint16_t low) noexcept {
+        return std::uint64_t(1) << (low % 64);
+      }
+
+      void _to_bitmap() {
+        _bitmap.assign(bitmap_words, 0);
+        for (std::uint16_t low : _array)
+          _bitmap[low / 64] |= _mask(low);
+        std::vector<std::uint16_t>().swap(_array);
+      }
+
+      void _to_array() {
+        _array.clear();
+        _array.reserve(_cardinality);
+        for_each([this](std::uint16_t low) { _array.push_back(low); });
+        std::vector<std::uint64_t>().swap(_bitmap);
+      }
+
+      void _recount() noexcept {
+        std::uint32_t cardinality = 0;
+        for (std::uint64_t word : _bitmap)
+          cardinality += static_cast<std::uint32_t>(std::popcount(word));
+        _cardinality = cardinality;
+      }
+
+      // Picks the cheaper representation after a bulk operation.
+      void _normalize() {
+        if (is_bitmap()) {
+          _recount();
+          if (_cardinality <= min_bitmap_size)
+            _to_array();
+        }
+        else {
+          _cardinality = static_cast<std::uint32_t>(_array.size());
+          if (_cardinality > max_array_size)
+            _to_bitmap();
+        }
+      }
+
+    public:
+      explicit roaring_container(std::uint16_t key) : _key(key) {}
+
+      std::uint16_t key() const noexcept { return _key; }
+      std::uint32_t cardinality() const noexcept { return _cardinality; }
+      bool empty() const noexcept { return _cardinality == 0; }
+      bool is_bitmap() const noexcept { return !_bitmap.empty(); }
+
+      bool contains(std::uint16_t low) const noexcept {
+        if (is_bitmap())
+          return (_bitmap[low / 64] & _mask(low)) != 0;
+        return std::binary_search(_array.begin(), _array.end(), low);
+      }
+
+      bool add(std::uint16_t low) {
+        if (is_bitmap()) {
+          std::uint64_t& word = _bitmap[low / 64];
+          if ((word & _mask(low)) != 0)
+            return false;
+          word |= _mask(low);
+        }
+        else {
+          auto it = std::lower_bound(_array.begin(), _array.end(), low);
+          if (it != _array.end() && *it == low)
+            return false;
+          _array.insert(it, low);
+          if (_array.size() > max_array_size)
+            _to_bitmap();
+        }
+        ++_cardinality;
+        return true;
+      }
+
+      bool remove(std::uint16_t low) {
+        if (is_bitmap()) {
+          std::uint64_t& word = _bitmap[low / 64];
+          if ((word & _mask(low)) == 0)
+            return false;
+          word &= ~_mask(low);
+          if (--_cardinality <= min_bitmap_size)
+            _to_array();
+        }
+        else {
+          auto it = std::lower_bound(_array.begin(), _array.end(), low);
+          if (it == _array.end() || *it != low)
+            return false;
+          _array.erase(it);
+          --_cardinality;
+        }
+        return true;
+      }
+
+      template <typename F>
+      void for_each(F&& f) const {
+        if (is_bitmap()) {
+          for (std::size_t i = 0; i < bitmap_words; ++i) {
+            for (std::uint64_t word = _bitmap[i]; word != 0; word &= word - 1)
+              f(static_cast<std::uint16_t>(i * 64 + static_cast<std::size_t>(std::countr_zero(word))));
+          }
+        }
+        else {
+          for (std::uint16_t low : _array)
+            f(low);
+        }
+      }
+
+      // Smallest value >= low, or -1.
+      std::int32_t next_from(std::uint32_t low) const noexcept {
+        if (low > 0xFFFF)
+          return -1;
+
+        if (!is_bitmap()) {
+          auto it = std::lower_bound(_array.begin(), _array.end(), static_cast<std::uint16_t>(low));
+          return it == _array.end() ? -1 : *it;
+        }
+
+        std::size_t i = low / 64;
+        std::uint64_t word = _bitmap[i] & ~((std::uint64_t(1) << (low % 64)) - 1);
+        while (word == 0) {
+          if (++i == bitmap_words)
+            return -1;
+          word = _bitmap[i];
+        }
+        return static_cast<std::int32_t>(i * 64 + static_cast<std::size_t>(std::countr_zero(word)));
+      }
+
+      roaring_container& operator&=(const roaring_container& other) {
+        if (is_bitmap() && other.is_bitmap()) {
+          for (std::size_t i = 0; i < bitmap_words; ++i)
+            _bitmap[i] &= other._bitmap[i];
+        }
+        else if (is_bitmap()) {
+          std::vector<std::uint16_t> result;
+          for (std::uint16_t low : other._array) {
+            if (contains(low))
+              result.push_back(low);
+          }
+          std::vector<std::uint64_t>().swap(_bitmap);
+          _array = std::move(result);
+        }
+        else if (other.is_bitmap()) {
+          std::erase_if(_array, [&other](std::uint16_t low) { return !other.contains(low); });
+        }
+        else {
+          std::vector<std::uint16_t> result;
+          std::set_intersection(_array.begin(), _array.end(), other._array.begin(), other._array.end(), std::back_inserter(result));
+          _array = std::move(result);
+        }
+        _normalize();
+        return *this;
+      }
+
+      roaring_container& operator|=(const roaring_container& other) {
+        if (!is_bitmap() && !other.is_bitmap()) {
+          std::vector<std::uint16_t> result;
+          result.reserve(_array.size() + other._array.size());
+          std::set_union(_array.begin(), _array.end(), other._array.begin(), other._array.end(), std::back_inserter(result));
+          _array = std::move(result);
+        }
+        else {
+          if (!is_bitmap())
+            _to_bitmap();
+          if (other.is_bitmap()) {
+            for (std::size_t i = 0; i < bitmap_words; ++i)
+              _bitmap[i] |= other._bitmap[i];
+          }
+          else {
+            for (std::uint16_t low : other._array)
+              _bitmap[low / 64] |= _mask(low);
+          }
+        }
+        _normalize();
+        return *this;
+      }
+
+      roaring_container& and_not(const roaring_container& other) {
+        if (is_bitmap() && other.is_bitmap()) {
+          for (std::size_t i = 0; i < bitmap_words; ++i)
+            _bitmap[i] &= ~other._bitmap[i];
+        }
+        else if (is_bitmap()) {
+          for (std::uint16_t low : other._array)
+            _bitmap[low / 64] &= ~_mask(low);
+        }
+        else if (other.is_bitmap()) {
+          std::erase_if(_array, [&other](std::uint16_t low) { return other.contains(low); });
+        }
+        else {
+          std::vector<std::uint16_t> result;
+          std::set_difference(_array.begin(), _array.end(), other._array.begin(), other._array.end(), std::back_inserter(result));
+          _array = std::move(result);
+        }
+        _normalize();
+        return *this;
+      }
+
+      std::uint32_t and_cardinality(const roaring_container& other) const noexcept {
+        std::uint32_t result = 0;
+        if (is_bitmap() && other.is_bitmap()) {
+          for (std::size_t i = 0; i < bitmap_words; ++i)
+            result += static_cast<std::uint32_t>(std::popcount(_bitmap[i] & other._bitmap[i]));
+        }
+        else if (is_bitmap() || other.is_bitmap()) {
+          const roaring_container& array = is_bitmap() ? other : *this;
+          const roaring_container& bitmap = is_bitmap() ? *this : other;
+          for (std::uint16_t low : array._array)
+            result += bitmap.contains(low);
+        }
+        else {
+          auto a = _array.begin(), b = other._array.begin();
+          while (a != _array.end() && b != other._array.end()) {
+            if (*a < *b) {
+              ++a;
+            }
+            else if (*b < *a) {
+              ++b;
+            }
+            else {
+              ++result;
+              ++a;
+              ++b;
+            }
+          }
+        }
+        return result;
+      }
+
+      bool intersects(const roaring_container& other) const noexcept {
+        if (is_bitmap() && other.is_bitmap()) {
+          for (std::size_t i = 0; i < bitmap_words; ++i) {
+            if ((_bitmap[i] & other._bitmap[i]) != 0)
+              return true;
+          }
+          return false;
+        }
+        if (is_bitmap() || other.is_bitmap()) {
+          const roaring_container& array = is_bitmap() ? other : *this;
+          const roaring_container& bitmap = is_bitmap() ? *this : other;
+          return std::any_of(array._array.begin(), array._array.end(),
+              [&bitmap](std::uint16_t low) { return bitmap.contains(low); });
+        }
+
+        auto a = _array.begin(), b = other._array.begin();
+        while (a != _array.end() && b != other._array.end()) {
+          if (*a < *b)
+            ++a;
+          else if (*b < *a)
+            ++b;
+          else
+            return true;
+        }
+        return false;
+      }
+
+      // Containers with the same values may differ in representation between
+      // min_bitmap_size and max_array_size.
+      friend bool operator==(const roaring_container& lhs, const roaring_container& rhs) {
+        if (lhs._key != rhs._key || lhs._cardinality != rhs._cardinality)
+          return false;
+        if (lhs.is_bitmap() == rhs.is_bitmap())
+          return lhs._array == rhs._array && lhs._bitmap == rhs._bitmap;
+
+        const roaring_container& array = lhs.is_bitmap() ? rhs : lhs;
+        const roaring_container& bitmap = lhs.is_bitmap() ? lhs : rhs;
+        return std::all_of(array._array.begin(), array._array.end(),
+            [&bitmap](std::uint16_t low) { return bitmap.contains(low); });
+      }
+    };
+  }
+
+  // Compressed bitmap of 32-bit values (roaring bitmap). Values are split by their high
+  // 16 bits into containers, each of which is a sorted array or a plain bitmap depending
+  // on its density. Set operations work container by container and skip keys present in
+  // only one operand, so sparse ID sets stay small and fast to intersect.
+  class roaring_bitmap {
+  public:
+    using value_type = std::uint32_t;
+    using size_type = std::size_t;
+
+  private:
+    using container_t = detail::roaring_container;
+
+    std::vector<container_t> _containers; // sorted by key
+
+    static std::uint16_t _high(value_type value) noexcept { return static_cast<std::uint16_t>(value >> 16); }
+    static std::uint16_t _low(value_type value) noexcept { return static_cast<std::uint16_t>(value & 0xFFFF); }
+
+    std::vector<container_t>::iterator _lower_bound(std::uint16_t key) {
+      return std::lower_bound(_containers.begin(), _containers.end(), key,
+          [](const container_t& c, std::uint16_t k) { return c.key() < k; });
+    }
+
+    std::vector<container_t>::const_iterator _lower_bound(std::uint16_t key) const {
+      return std::lower_bound(_containers.begin(), _containers.end(), key,
+          [](const container_t& c, std::uint16_t k) { return c.key() < k; });
+    }
+
+  public:
+    class iterator {
+      friend class roaring_bitmap;
+    private:
+      const roaring_bitmap* _bitmap = nullptr;
+      size_type _container = 0;
+      std::uint32_t _low = 0;
+
+      iterator(const roaring_bitmap* bitmap, size_type container, std::uint32_t low) noexcept
+          : _bitmap(bitmap), _container(container), _low(low) {
+        _settle();
+      }
+
+      // Moves to the first value >= current position.
+      void _settle() noexcept {
+        while (_container < _bitmap->_containers.size()) {
+          std::int32_t next = _bitmap->_containers[_container].next_from(_low);
+          if (next >= 0) {
+            _low = static_cast<std::uint32_t>(next);
+            return;
+          }
+          ++_container;
+          _low = 0;
+        }
+        _low = 0;
+      }
+
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::uint32_t;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const std::uint32_t*;
+      using reference = std::uint32_t;
+
+      iterator() noexcept = default;
+
+      std::uint32_t operator*() const noexcept {
+        return (std::uint32_t(_bitmap->_containers[_container].key()) << 16) | _low;
+      }
+
+      iterator& operator++() noexcept {
+        ++_low;
+        _settle();
+        return *this;
+      }
+
+      iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+
+      bool operator==(const iterator& other) const noexcept {
+        return _container == other._container && _low == other._low;
+      }
+    };
+
+    using const_iterator = iterator;
+
+    roaring_bitmap() = default;
+
+    roaring_bitmap(std::initializer_list<value_type> values) {
+      for (value_type value : values)
+        add(value);
+    }
+
+    iterator begin() const noexcept { return {this, 0, 0}; }
+    iterator end() const noexcept { return {this, _containers.size(), 0}; }
+
+    bool empty() const noexcept { return _containers.empty(); }
+
+    size_type cardinality() const noexcept {
+      size_type result = 0;
+      for (const auto& c : _containers)
+        result += c.cardinality();
+      return result;
+    }
+
+    size_type size() const noexcept { return cardinality(); }
+
+    bool contains(value_type value) const noexcept {
+      auto it = _lower_bound(_high(value));
+      return it != _containers.end() && it->key() == _high(value) && it->contains(_low(value));
+    }
+
+    bool add(value_type value) {
+      auto it = _lower_bound(_high(value));
+      if (it == _containers.end() || it->key() != _high(value))
+        it = _containers.emplace(it, _high(value));
+      return it->add(_low(value));
+    }
+
+    bool remove(value_type value) {
+      auto it = _lower_bound(_high(value));
+      if (it == _containers.end() || it->key() != _high(value))
+        return false;
+
+      bool removed = it->remove(_low(value));
+      if (it->empty())
+        _containers.erase(it);
+      return removed;
+    }
+
+    void clear() noexcept {
+      _containers.clear();
+    }
+
+    template <typename F>
+    void for_each(F&& f) const {
+      for (const auto& c : _containers) {
+        std::uint32_t high = std::uint32_t(c.key()) << 16;
+        c.for_each([&f, high](std::uint16_t low) { f(high | low); });
+      }
+    }
+
+    std::vector<value_type> to_vector() const {
+      std::vector<value_type> result;
+      result.reserve(cardinality());
+      for_each([&result](value_type value) { result.push_back(value); });
+      return result;
+    }
+
+    roaring_bitmap& operator&=(const roaring_bitmap& other) {
+      std::vector<container_t> result;
+      auto a = _containers.begin();
+      auto b = other._containers.begin();
+      while (a != _containers.end() && b != other._containers.end()) {
+        if (a->key() < b->key()) {
+          ++a;
+        }
+        else if (b->key() < a->key()) {
+          ++b;
+        }
+        else {
+          *a &= *b;
+          if (!a->empty())
+            result.push_back(std::move(*a));
+          ++a;
+          ++b;
+        }
+      }
+      _containers = std::move(result);
+      return *this;
+    }
+
+    roaring_bitmap& operator|=(const roaring_bitmap& other) {
+      std::vector<container_t> result;
+      result.reserve(_containers.size() + other._containers.size());
+      auto a = _containers.begin();
+      auto b = other._containers.begin();
+      while (a != _containers.end() || b != other._containers.end()) {
+        if (b == other._containers.end() || (a != _containers.end() && a->key() < b->key())) {
+          result.push_back(std::move(*a++));
+        }
+        else if (a == _containers.end() || b->key() < a->key()) {
+          result.push_back(*b++);
+        }
+        else {
+          *a |= *b++;
+          result.push_back(std::move(*a++));
+        }
+      }
+      _containers = std::move(result);
+      return *this;
+    }
+
+    // *this &= ~other
+    roaring_bitmap& and_not(const roaring_bitmap& other) {
+      std::vector<container_t> result;
+      auto b = other._containers.begin();
+      for (auto& c : _containers) {
+        while (b != other._containers.end() && b->key() < c.key())
+          ++b;
+        if (b != other._containers.end() && b->key() == c.key())
+          c.and_not(*b);
+        if (!c.empty())
+          result.push_back(std::move(c));
+      }
+      _containers = std::move(result);
+      return *this;
+    }
+
+    roaring_bitmap& operator-=(const roaring_bitmap& other) { return and_not(other); }
+
+    friend roaring_bitmap operator&(roaring_bitmap lhs, const roaring_bitmap& rhs) { return lhs &= rhs; }
+    friend roaring_bitmap operator|(roaring_bitmap lhs, const roaring_bitmap& rhs) { return lhs |= rhs; }
+    friend roaring_bitmap operator-(roaring_bitmap lhs, const roaring_bitmap& rhs) { return lhs -= rhs; }
+
+    // |*this & other| without materializing the intersection.
+    size_type and_cardinality(const roaring_bitmap& other) const noexcept {
+      size_type result = 0;
+      auto a = _containers.begin();
+      auto b = other._containers.begin();
+      while (a != _containers.end() && b != other._containers.end()) {
+        if (a->key() < b->key()) {
+          ++a;
+        }
+        else if (b->key() < a->key()) {
+          ++b;
+        }
+        else {
+          result += (a++)->and_cardinality(*b++);
+        }
+      }
+      return result;
+    }
+
+    // Stops at the first common value.
+    bool intersects(const roaring_bitmap& other) const noexcept {
+      auto a = _containers.begin();
+      auto b = other._containers.begin();
+      while (a != _containers.end() && b != other._containers.end()) {
+        if (a->key() < b->key()) {
+          ++a;
+        }
+        else if (b->key() < a->key()) {
+          ++b;
+        }
+        else if ((a++)->intersects(*b++)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    friend bool operator==(const roaring_bitmap& lhs, const roaring_bitmap& rhs) {
+      return lhs._containers == rhs._containers;
+    }
+  };
+}
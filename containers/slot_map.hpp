@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint32_t
+#include <functional> // std::hash
+#include <memory> // std::allocator, std::allocator_traits
+#include <stdexcept> // std::out_of_range
+#include <utility> // std::move, std::forward
+#include <vector>
+
+namespace xlib::container {
+  // Reference to an element of a slot_map. A handle stays valid until its element is erased;
+  // after that it is detected as stale even if the slot has been reused.
+  struct slot_map_handle {
+    std::uint32_t index = static_cast<std::uint32_t>(-1);
+    std::uint32_t generation = 0;
+
+    friend bool operator==(const slot_map_handle&, const slot_map_handle&) = default;
+  };
+
+  // Elements are stored densely in one vector (so iteration is a plain array walk) and are
+  // addressed through slot_map_handle. Insert and erase are O(1); erase moves the last
+  // element into the hole, so pointers and iterators are not stable, handles are.
+  template <typename T, class Allocator = std::allocator<T>>
+  class slot_map {
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using handle = slot_map_handle;
+    using iterator = typename std::vector<T, Allocator>::iterator;
+    using const_iterator = typename std::vector<T, Allocator>::const_iterator;
+
+  private:
+    struct slot {
+      std::uint32_t index;      // position in _values while occupied, next free slot otherwise
+      std::uint32_t generation; // incremented on every erase
+    };
+
+    template <typename U>
+    using rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+    static constexpr std::uint32_t no_slot = static_cast<std::uint32_t>(-1);
+
+    std::vector<T, Allocator> _values;
+    std::vector<std::uint32_t, rebind<std::uint32_t>> _value_slots; // _values[i] lives in _slots[_value_slots[i]]
+    std::vector<slot, rebind<slot>> _slots;
+    std::uint32_t _free_head = no_slot;
+
+    const slot* _find_slot(handle h) const noexcept {
+      if (h.index >= _slots.size())
+        return nullptr;
+      const slot& s = _slots[h.index];
+      return s.generation == h.generation ? &s : nullptr;
+    }
+
+  public:
+    slot_map() = default;
+
+    explicit slot_map(const Allocator& allocator)
+        : _values(allocator), _value_slots(allocator), _slots(allocator) {}
+
+    iterator begin() noexcept { return _values.begin(); }
+    const_iterator begin() const noexcept { return _values.begin(); }
+    iterator end() noexcept { return _values.end(); }
+    const_iterator end() const noexcept { return _values.end(); }
+
+    T* data() noexcept { return _values.data(); }
+    const T* data() const noexcept { return _values.data(); }
+
+    bool empty() const noexcept { return _values.empty(); }
+    size_type size() const noexcept { return _values.size(); }
+    size_type capacity() const noexcept { return _values.capacity(); }
+
+    void reserve(size_type count) {
+      _values.reserve(count);
+      _value_slots.reserve(count);
+      _slots.reserve(count);
+    }
+
+    template <typename... Args>
+    handle emplace(Args&&... args) {
+      std::uint32_t slot_index = _free_head;
+      if (slot_index == no_slot) {
+        if (_slots.size() == no_slot)
+          throw std::length_error("xlib::container::slot_map: too many slots");
+        slot_index = static_cast<std::uint32_t>(_slots.size());
+        _slots.push_back({0, 0});
+      }
+
+      try {
+        _values.emplace_back(std::forward<Args>(args)...);
+        try {
+          _value_slots.push_back(slot_index);
+        }
+        catch (...) {
+          _values.pop_back();
+          throw;
+        }
+      }
+      catch (...) {
+        if (slot_index != _free_head)
+          _slots.pop_back();
+        throw;
+      }
+
+      slot& s = _slots[slot_index];
+      if (slot_index == _free_head)
+        _free_head = s.index;
+      s.index = static_cast<std::uint32_t>(_values.size() - 1);
+
+      return {slot_index, s.generation};
+    }
+
+    handle insert(const T& value) { return emplace(value); }
+    handle insert(T&& value) { return emplace(std::move(value)); }
+
+    // Returns false if the handle is stale.
+    bool erase(handle h) {
+      if (_find_slot(h) == nullptr)
+        return false;
+
+      slot& s = _slots[h.index];
+      std::uint32_t value_index = s.index;
+      std::uint32_t last = static_cast<std::uint32_t>(_values.size() - 1);
+
+      if (value_index != last) {
+        _values[value_index] = std::move(_values[last]);
+        _value_slots[value_index] = _value_slots[last];
+        _slots[_value_slots[value_index]].index = value_index;
+      }
+      _values.pop_back();
+      _value_slots.pop_back();
+
+      ++s.generation;
+      s.index = _free_head;
+      _free_head = h.index;
+
+      return true;
+    }
+
+    // Erases the element at it and returns an iterator to the element which took its place.
+    iterator erase(const_iterator it) {
+      size_type i = static_cast<size_type>(it - _values.cbegin());
+      erase(handle_of(i));
+      return _values.begin() + static_cast<std::ptrdiff_t>(i);
+    }
+
+    bool contains(handle h) const noexcept {
+      return _find_slot(h) != nullptr;
+    }
+
+    // nullptr for stale handles.
+    T* find(handle h) noexcept {
+      const slot* s = _find_slot(h);
+      return s == nullptr ? nullptr : &_values[s->index];
+    }
+
+    const T* find(handle h) const noexcept {
+      const slot* s = _find_slot(h);
+      return s == nullptr ? nullptr : &_values[s->index];
+    }
+
+    T& at(handle h) {
+      T* ptr = find(h);
+      if (ptr == nullptr)
+        throw std::out_of_range("xlib::container::slot_map::at(): stale handle");
+      return *ptr;
+    }
+
+    const T& at(handle h) const {
+      const T* ptr = find(h);
+      if (ptr == nullptr)
+        throw std::out_of_range("xlib::container::slot_map::at(): stale handle");
+      return *ptr;
+    }
+
+    T& operator[](handle h) noexcept { return _values[_slots[h.index].index]; }
+    const T& operator[](handle h) const noexcept { return _values[_slots[h.index].index]; }
+
+    // Handle of the element at dense position i (e.g. while iterating).
+    handle handle_of(size_type i) const noexcept {
+      std::uint32_t slot_index = _value_slots[i];
+      return {slot_index, _slots[slot_index].generation};
+    }
+
+    // Invalidates every handle.
+    void clear() {
+      while (!_values.empty())
+        erase(handle_of(_values.size() - 1));
+    }
+  };
+}
+
+template <>
+struct std::hash<xlib::container::slot_map_handle> {
+  std::size_t operator()(const xlib::container::slot_map_handle& h) const noexcept {
+    return std::hash<std::uint64_t>{}((std::uint64_t(h.generation) << 32) | h.index);
+  }
+};
@@ -0,0 +1,388 @@
+#pragma once
+
+#include <algorithm> // std::equal, std::rotate, std::max
+#include <compare>
+#include <cstddef> // std::size_t, std::ptrdiff_t, std::byte
+#include <initializer_list>
+#include <iterator> // std::reverse_iterator
+#include <limits>
+#include <memory> // std::allocator, std::allocator_traits, std::uninitialized_*
+#include <stdexcept> // std::out_of_range, std::length_error
+#include <type_traits>
+#include <utility> // std::move, std::forward, std::swap
+
+namespace xlib::container {
+  // Vector which keeps up to N elements inside the object and spills to memory
+  // from Allocator only when it grows beyond that.
+  template <typename T, std::size_t N = 8, class Allocator = std::allocator<T>>
+  class small_vector {
+  public:
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  private:
+    using ATR = std::allocator_traits<Allocator>;
+
+    pointer _data;
+    size_type _size = 0;
+    size_type _capacity = N;
+
+    [[no_unique_address]] Allocator _allocator;
+
+    alignas(T) std::byte _inline[sizeof(T) * (N == 0 ? 1 : N)];
+
+    pointer _inline_data() noexcept {
+      return reinterpret_cast<pointer>(_inline);
+    }
+
+    bool _is_inline() const noexcept {
+      return _data == reinterpret_cast<const_pointer>(_inline);
+    }
+
+    void _free_heap() noexcept {
+      if (!_is_inline())
+        ATR::deallocate(_allocator, _data, _capacity);
+    }
+
+    size_type _next_capacity(size_type required) const {
+      if (required > max_size())
+        throw std::length_error("xlib::container::small_vector: required capacity is too big");
+      return std::max(required, _capacity * 2);
+    }
+
+    // Moves the elements into new_data, or copies them when a throwing move
+    // would lose the strong guarantee. On exception nothing is left constructed.
+    void _transfer_to(pointer new_data) {
+      if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>)
+        std::uninitialized_move(begin(), end(), new_data);
+      else
+        std::uninitialized_copy(begin(), end(), new_data);
+    }
+
+    void _adopt(pointer new_data, size_type new_capacity) noexcept {
+      std::destroy(begin(), end());
+      _free_heap();
+      _data = new_data;
+      _capacity = new_capacity;
+    }
+
+    void _relocate(size_type new_capacity) {
+      pointer new_data = ATR::allocate(_allocator, new_capacity);
+      try {
+        _transfer_to(new_data);
+      }
+      catch (...) {
+        ATR::deallocate(_allocator, new_data, new_capacity);
+        throw;
+      }
+      _adopt(new_data, new_capacity);
+    }
+
+    void _steal(small_vector& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+      if (other._is_inline()) {
+        std::uninitialized_move(other.begin(), other.end(), _data);
+        _size = other._size;
+        other.clear();
+      }
+      else {
+        _data = other._data;
+        _size = other._size;
+        _capacity = other._capacity;
+        other._data = other._inline_data();
+        other._size = 0;
+        other._capacity = N;
+      }
+    }
+
+  public:
+    small_vector() noexcept(noexcept(Allocator())) : _data(_inline_data()) {}
+
+    explicit small_vector(const Allocator& allocator) noexcept
+        : _data(_inline_data()), _allocator(allocator) {}
+
+    explicit small_vector(size_type count, const Allocator& allocator = {})
+        : small_vector(allocator) {
+      resize(count);
+    }
+
+    small_vector(size_type count, const T& value, const Allocator& allocator = {})
+        : small_vector(allocator) {
+      assign(count, value);
+    }
+
+    template <typename InputIt>
+    requires (!std::is_integral_v<InputIt>)
+    small_vector(InputIt first, InputIt last, const Allocator& allocator = {})
+        : small_vector(allocator) {
+      assign(first, last);
+    }
+
+    small_vector(std::initializer_list<T> list, const Allocator& allocator = {})
+        : small_vector(allocator) {
+      assign(list.begin(), list.end());
+    }
+
+    small_vector(const small_vector& other)
+        : small_vector(ATR::select_on_container_copy_construction(other._allocator)) {
+      assign(other.begin(), other.end());
+    }
+
+    small_vector(small_vector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        : _data(_inline_data()), _allocator(std::move(other._allocator)) {
+      _steal(other);
+    }
+
+    ~small_vector() {
+      clear();
+      _free_heap();
+    }
+
+    small_vector& operator=(const small_vector& other) {
+      if (this != &other)
+        assign(other.begin(), other.end());
+      return *this;
+    }
+
+    small_vector& operator=(small_vector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+      if (this != &other) {
+        clear();
+        if (!ATR::propagate_on_container_move_assignment::value
+            && !other._is_inline() && _allocator != other._allocator) {
+          assign(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+          other.clear();
+          return *this;
+        }
+        _free_heap();
+        _data = _inline_data();
+        _capacity = N;
+        if constexpr (ATR::propagate_on_container_move_assignment::value)
+          _allocator = std::move(other._allocator);
+        _steal(other);
+      }
+      return *this;
+    }
+
+    small_vector& operator=(std::initializer_list<T> list) {
+      assign(list.begin(), list.end());
+      return *this;
+    }
+
+    void assign(size_type count, const T& value) {
+      clear();
+      reserve(count);
+      std::uninitialized_fill_n(_data, count, value);
+      _size = count;
+    }
+
+    template <typename InputIt>
+    requires (!std::is_integral_v<InputIt>)
+    void assign(InputIt first, InputIt last) {
+      clear();
+      if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>)
+        reserve(static_cast<size_type>(std::distance(first, last)));
+      for (; first != last; ++first)
+        emplace_back(*first);
+    }
+
+    allocator_type get_allocator() const { return _allocator; }
+
+    iterator begin() noexcept { return _data; }
+    const_iterator begin() const noexcept { return _data; }
+    const_iterator cbegin() const noexcept { return _data; }
+
+    iterator end() noexcept { return _data + _size; }
+    const_iterator end() const noexcept { return _data + _size; }
+    const_iterator cend() const noexcept { return _data + _size; }
+
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    bool empty() const noexcept { return _size == 0; }
+    size_type size() const noexcept { return _size; }
+    size_type capacity() const noexcept { return _capacity; }
+    size_type max_size() const noexcept { return ATR::max_size(_allocator); }
+    static constexpr size_type inline_capacity() noexcept { return N; }
+    bool is_inline() const noexcept { return _is_inline(); }
+
+    pointer data() noexcept { return _data; }
+    const_pointer data() const noexcept { return _data; }
+
+    reference operator[](size_type i) { return _data[i]; }
+    const_reference operator[](size_type i) const { return _data[i]; }
+
+    reference at(size_type i) {
+      if (i >= _size)
+        throw std::out_of_range("xlib::container::small_vector::at(): index out of range");
+      return _data[i];
+    }
+
+    const_reference at(size_type i) const {
+      if (i >= _size)
+        throw std::out_of_range("xlib::container::small_vector::at(): index out of range");
+      return _data[i];
+    }
+
+    reference front() { return _data[0]; }
+    const_reference front() const { return _data[0]; }
+    reference back() { return _data[_size - 1]; }
+    const_reference back() const { return _data[_size - 1]; }
+
+    void reserve(size_type count) {
+      if (count > _capacity)
+        _relocate(_next_capacity(count));
+    }
+
+    void shrink_to_fit() {
+      if (_is_inline() || _size == _capacity)
+        return;
+
+      if (_size <= N) {
+        pointer old_data = _data;
+        size_type old_capacity = _capacity;
+        std::uninitialized_move(begin(), end(), _inline_data());
+        std::destroy(begin(), end());
+        _data = _inline_data();
+        _capacity = N;
+        ATR::deallocate(_allocator, old_data, old_capacity);
+      }
+      else {
+        _relocate(_size);
+      }
+    }
+
+    template <typename... Args>
+    reference emplace_back(Args&&... args) {
+      if (_size == _capacity) {
+        // args may refer to an element of this vector, so construct the new element before relocation
+        size_type new_capacity = _next_capacity(_size + 1);
+        pointer new_data = ATR::allocate(_allocator, new_capacity);
+        try {
+          ATR::construct(_allocator, new_data + _size, std::forward<Args>(args)...);
+        }
+        catch (...) {
+          ATR::deallocate(_allocator, new_data, new_capacity);
+          throw;
+        }
+        try {
+          _transfer_to(new_data);
+        }
+        catch (...) {
+          ATR::destroy(_allocator, new_data + _size);
+          ATR::deallocate(_allocator, new_data, new_capacity);
+          throw;
+        }
+        _adopt(new_data, new_capacity);
+      }
+      else {
+        ATR::construct(_allocator, _data + _size, std::forward<Args>(args)...);
+      }
+      return _data[_size++];
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_back() {
+      --_size;
+      ATR::destroy(_allocator, _data + _size);
+    }
+
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args&&... args) {
+      size_type index = pos - begin();
+      emplace_back(std::forward<Args>(args)...);
+      std::rotate(begin() + index, end() - 1, end());
+      return begin() + index;
+    }
+
+    iterator insert(const_iterator pos, const T& value) { return emplace(pos, value); }
+    iterator insert(const_iterator pos, T&& value) { return emplace(pos, std::move(value)); }
+
+    template <typename InputIt>
+    requires (!std::is_integral_v<InputIt>)
+    iterator insert(const_iterator pos, InputIt first, InputIt last) {
+      size_type index = pos - begin();
+      size_type old_size = _size;
+      for (; first != last; ++first)
+        emplace_back(*first);
+      std::rotate(begin() + index, begin() + old_size, end());
+      return begin() + index;
+    }
+
+    iterator insert(const_iterator pos, std::initializer_list<T> list) {
+      return insert(pos, list.begin(), list.end());
+    }
+
+    iterator erase(const_iterator pos) {
+      return erase(pos, pos + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+      iterator f = begin() + (first - begin());
+      iterator l = begin() + (last - begin());
+      if (f != l) {
+        iterator new_end = std::move(l, end(), f);
+        std::destroy(new_end, end());
+        _size = new_end - begin();
+      }
+      return f;
+    }
+
+    void resize(size_type count) {
+      if (count < _size) {
+        std::destroy(begin() + count, end());
+      }
+      else {
+        reserve(count);
+        std::uninitialized_value_construct(end(), begin() + count);
+      }
+      _size = count;
+    }
+
+    void resize(size_type count, const T& value) {
+      if (count < _size) {
+        std::destroy(begin() + count, end());
+      }
+      else {
+        reserve(count);
+        std::uninitialized_fill(end(), begin() + count, value);
+      }
+      _size = count;
+    }
+
+    void clear() noexcept {
+      std::destroy(begin(), end());
+      _size = 0;
+    }
+
+    void swap(small_vector& other) {
+      small_vector tmp(std::move(other));
+      other = std::move(*this);
+      *this = std::move(tmp);
+    }
+
+    friend void swap(small_vector& lhs, small_vector& rhs) {
+      lhs.swap(rhs);
+    }
+
+    friend bool operator==(const small_vector& lhs, const small_vector& rhs) {
+      return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+    friend auto operator<=>(const small_vector& lhs, const small_vector& rhs) {
+      return std::lexicographical_compare_three_way(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+  };
+}
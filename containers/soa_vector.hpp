@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm> // std::max
+#include <compare>
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <iterator> // std::random_access_iterator_tag
+#include <memory> // std::allocator, std::uninitialized_*, std::destroy
+#include <span>
+#include <stdexcept> // std::out_of_range
+#include <tuple>
+#include <type_traits>
+#include <utility> // std::index_sequence, std::move, std::forward
+
+namespace xlib::container {
+  // Struct-of-arrays vector: every field is kept in its own contiguous array, so loops
+  // over a few fields only touch the memory of those fields. Elements are accessed through
+  // tuples of references (structured bindings work), and whole fields through get<I>().
+  template <typename... Fields>
+  class soa_vector {
+    static_assert(sizeof...(Fields) != 0, "xlib::container::soa_vector: at least one field is required");
+
+  public:
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::tuple<Fields...>;
+    using reference = std::tuple<Fields&...>;
+    using const_reference = std::tuple<const Fields&...>;
+
+    template <std::size_t I>
+    using field_type = std::tuple_element_t<I, value_type>;
+
+    static constexpr std::size_t field_count = sizeof...(Fields);
+
+  private:
+    using indices = std::index_sequence_for<Fields...>;
+
+    using pointers_t = std::tuple<Fields*...>;
+
+    // Relocation moves only when every field moves without throwing; otherwise it copies,
+    // so a failure can't leave some fields of the old elements moved-from.
+    static constexpr bool _nothrow_relocate = (std::is_nothrow_move_constructible_v<Fields> && ...);
+
+    pointers_t _data{};
+    size_type _size = 0;
+    size_type _capacity = 0;
+
+    template <typename F>
+    static F* _allocate(size_type count) {
+      return std::allocator<F>().allocate(count);
+    }
+
+    template <typename F>
+    static void _deallocate(F* ptr, size_type count) noexcept {
+      if (ptr != nullptr)
+        std::allocator<F>().deallocate(ptr, count);
+    }
+
+    template <std::size_t... I>
+    static void _deallocate_all(const pointers_t& data, size_type count, std::index_sequence<I...>) noexcept {
+      (_deallocate(std::get<I>(data), count), ...);
+    }
+
+    template <std::size_t... I>
+    static pointers_t _allocate_all(size_type count, std::index_sequence<I...>) {
+      pointers_t data{};
+      try {
+        ((std::get<I>(data) = _allocate<Fields>(count)), ...);
+      }
+      catch (...) {
+        _deallocate_all(data, count, indices{});
+        throw;
+      }
+      return data;
+    }
+
+    template <std::size_t... I>
+    static void _destroy_range(const pointers_t& data, size_type first, size_type last, std::index_sequence<I...>) noexcept {
+      (std::destroy(std::get<I>(data) + first, std::get<I>(data) + last), ...);
+    }
+
+    // Builds one field per argument; if a field throws, the ones already built are destroyed.
+    template <std::size_t... I, typename... Args>
+    static void _construct_element(const pointers_t& data, size_type index, std::index_sequence<I...>, Args&&... args) {
+      std::size_t built = 0;
+      try {
+        ((std::construct_at(std::get<I>(data) + index, std::forward<Args>(args)), ++built), ...);
+      }
+      catch (...) {
+        ((I < built ? std::destroy_at(std::get<I>(data) + index) : void()), ...);
+        throw;
+      }
+    }
+
+    template <std::size_t... I>
+    void _value_construct_range(size_type first, size_type last, std::index_sequence<I...>) {
+      std::size_t built = 0;
+      try {
+        ((std::uninitialized_value_construct(std::get<I>(_data) + first, std::get<I>(_data) + last), ++built), ...);
+      }
+      catch (...) {
+        ((I < built ? std::destroy(std::get<I>(_data) + first, std::get<I>(_data) + last) : void()), ...);
+        throw;
+      }
+    }
+
+    template <typename F>
+    void _transfer_field(F* from, F* to) {
+      if constexpr (_nothrow_relocate || !std::is_copy_constructible_v<F>)
+        std::uninitialized_move(from, from + _size, to);
+      else
+        std::uninitialized_copy(from, from + _size, to);
+    }
+
+    // Moves or copies the elements into new_data; on exception nothing is left constructed there.
+    template <std::size_t... I>
+    void _transfer_to(const pointers_t& new_data, std::index_sequence<I...>) {
+      std::size_t done = 0;
+      try {
+        ((_transfer_field(std::get<I>(_data), std::get<I>(new_data)), ++done), ...);
+      }
+      catch (...) {
+        ((I < done ? std::destroy(std::get<I>(new_data), std::get<I>(new_data) + _size) : void()), ...);
+        throw;
+      }
+    }
+
+    void _adopt(const pointers_t& new_data, size_type new_capacity) noexcept {
+      _destroy_range(_data, 0, _size, indices{});
+      _deallocate_all(_data, _capacity, indices{});
+      _data = new_data;
+      _capacity = new_capacity;
+    }
+
+    void _relocate(size_type new_capacity) {
+      // allocate every array first so that a failure leaves *this untouched
+      pointers_t new_data = _allocate_all(new_capacity, indices{});
+      try {
+        _transfer_to(new_data, indices{});
+      }
+      catch (...) {
+        _deallocate_all(new_data, new_capacity, indices{});
+        throw;
+      }
+      _adopt(new_data, new_capacity);
+    }
+
+    template <std::size_t... I>
+    reference _at(size_type i, std::index_sequence<I...>) noexcept {
+      return reference(std::get<I>(_data)[i]...);
+    }
+
+    template <std::size_t... I>
+    const_reference _at(size_type i, std::index_sequence<I...>) const noexcept {
+      return const_reference(std::get<I>(_data)[i]...);
+    }
+
+    template <std::size_t... I>
+    void _move_element(size_type to, size_type from, std::index_sequence<I...>) {
+      ((std::get<I>(_data)[to] = std::move(std::get<I>(_data)[from])), ...);
+    }
+
+    template <bool is_const>
+    class _base_iterator {
+      friend class soa_vector<Fields...>;
+    private:
+      using owner_t = std::conditional_t<is_const, const soa_vector, soa_vector>;
+
+      owner_t* _owner = nullptr;
+      size_type _index = 0;
+
+      _base_iterator(owner_t* owner, size_type index) noexcept : _owner(owner), _index(index) {}
+
+    public:
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type = soa_vector::value_type;
+      using difference_type = std::ptrdiff_t;
+      using reference = std::conditional_t<is_const, soa_vector::const_reference, soa_vector::reference>;
+
+      _base_iterator() noexcept = default;
+
+      template <bool other_const>
+      requires (is_const && !other_const)
+      _base_iterator(const _base_iterator<other_const>& other) noexcept : _owner(other._owner), _index(other._index) {}
+
+      reference operator*() const noexcept { return (*_owner)[_index]; }
+      reference operator[](difference_type n) const noexcept { return (*_owner)[_index + n]; }
+
+      _base_iterator& operator++() noexcept { ++_index; return *this; }
+      _base_iterator operator++(int) noexcept { auto tmp = *this; ++_index; return tmp; }
+      _base_iterator& operator--() noexcept { --_index; return *this; }
+      _base_iterator operator--(int) noexcept { auto tmp = *this; --_index; return tmp; }
+
+      _base_iterator& operator+=(difference_type n) noexcept { _index += n; return *this; }
+      _base_iterator& operator-=(difference_type n) noexcept { _index -= n; return *this; }
+
+      friend _base_iterator operator+(_base_iterator it, difference_type n) noexcept { return it += n; }
+      friend _base_iterator operator+(difference_type n, _base_iterator it) noexcept { return it += n; }
+      friend _base_iterator operator-(_base_iterator it, difference_type n) noexcept { return it -= n; }
+
+      friend difference_type operator-(const _base_iterator& lhs, const _base_iterator& rhs) noexcept {
+        return static_cast<difference_type>(lhs._index) - static_cast<difference_type>(rhs._index);
+      }
+
+      bool operator==(const _base_iterator& other) const noexcept { return _index == other._index; }
+      auto operator<=>(const _base_iterator& other) const noexcept { return _index <=> other._index; }
+    };
+
+  public:
+    using iterator = _base_iterator<false>;
+    using const_iterator = _base_iterator<true>;
+
+    soa_vector() noexcept = default;
+
+    explicit soa_vector(size_type count) {
+      resize(count);
+    }
+
+    soa_vector(const soa_vector& other) {
+      reserve(other._size);
+      for (size_type i = 0; i < other._size; ++i)
+        push_back(other[i]);
+    }
+
+    soa_vector(soa_vector&& other) noexcept
+        : _data(std::exchange(other._data, {}))
+        , _size(std::exchange(other._size, 0))
+        , _capacity(std::exchange(other._capacity, 0)) {}
+
+    soa_vector& operator=(const soa_vector& other) {
+      if (this != &other) {
+        soa_vector tmp(other);
+        swap(tmp);
+      }
+      return *this;
+    }
+
+    soa_vector& operator=(soa_vector&& other) noexcept {
+      if (this != &other) {
+        soa_vector tmp(std::move(other));
+        swap(tmp);
+      }
+      return *this;
+    }
+
+    ~soa_vector() {
+      clear();
+      _deallocate_all(_data, _capacity, indices{});
+    }
+
+    iterator begin() noexcept { return {this, 0}; }
+    const_iterator begin() const noexcept { return {this, 0}; }
+    iterator end() noexcept { return {this, _size}; }
+    const_iterator end() const noexcept { return {this, _size}; }
+
+    bool empty() const noexcept { return _size == 0; }
+    size_type size() const noexcept { return _size; }
+    size_type capacity() const noexcept { return _capacity; }
+
+    reference operator[](size_type i) noexcept { return _at(i, indices{}); }
+    const_reference operator[](size_type i) const noexcept { return _at(i, indices{}); }
+
+    reference at(size_type i) {
+      if (i >= _size)
+        throw std::out_of_range("xlib::container::soa_vector::at(): index out of range");
+      return _at(i, indices{});
+    }
+
+    const_reference at(size_type i) const {
+      if (i >= _size)
+        throw std::out_of_range("xlib::container::soa_vector::at(): index out of range");
+      return _at(i, indices{});
+    }
+
+    reference front() noexcept { return (*this)[0]; }
+    reference back() noexcept { return (*this)[_size - 1]; }
+
+    // Whole field I as a contiguous array.
+    template <std::size_t I>
+    std::span<field_type<I>> get() noexcept {
+      return {std::get<I>(_data), _size};
+    }
+
+    template <std::size_t I>
+    std::span<const field_type<I>> get() const noexcept {
+      return {std::get<I>(_data), _size};
+    }
+
+    template <std::size_t I>
+    field_type<I>* data() noexcept { return std::get<I>(_data); }
+
+    template <std::size_t I>
+    const field_type<I>* data() const noexcept { return std::get<I>(_data); }
+
+    void reserve(size_type count) {
+      if (count > _capacity)
+        _relocate(count);
+    }
+
+    void shrink_to_fit() {
+      if (_size != _capacity)
+        _relocate(_size);
+    }
+
+    // One argument per field.
+    template <typename... Args>
+    requires (sizeof...(Args) == sizeof...(Fields))
+    reference emplace_back(Args&&... args) {
+      if (_size == _capacity) {
+        // args may refer to an element of this vector, so construct the new element before relocation
+        size_type new_capacity = std::max<size_type>(_size + 1, _capacity * 2);
+        pointers_t new_data = _allocate_all(new_capacity, indices{});
+        try {
+          _construct_element(new_data, _size, indices{}, std::forward<Args>(args)...);
+        }
+        catch (...) {
+          _deallocate_all(new_data, new_capacity, indices{});
+          throw;
+        }
+        try {
+          _transfer_to(new_data, indices{});
+        }
+        catch (...) {
+          _destroy_range(new_data, _size, _size + 1, indices{});
+          _deallocate_all(new_data, new_capacity, indices{});
+          throw;
+        }
+        _adopt(new_data, new_capacity);
+      }
+      else {
+        _construct_element(_data, _size, indices{}, std::forward<Args>(args)...);
+      }
+      return (*this)[_size++];
+    }
+
+    void push_back(const Fields&... fields) {
+      emplace_back(fields...);
+    }
+
+    template <typename... Args>
+    void push_back(const std::tuple<Args...>& element) {
+      std::apply([this](const auto&... fields) { emplace_back(fields...); }, element);
+    }
+
+    void pop_back() noexcept {
+      --_size;
+      _destroy_range(_data, _size, _size + 1, indices{});
+    }
+
+    // O(1): moves the last element into the gap, so the order is not preserved.
+    void swap_erase(size_type i) {
+      if (i != _size - 1)
+        _move_element(i, _size - 1, indices{});
+      pop_back();
+    }
+
+    // O(n): keeps the order of the remaining elements.
+    void erase(size_type i) {
+      for (; i + 1 < _size; ++i)
+        _move_element(i, i + 1, indices{});
+      pop_back();
+    }
+
+    void resize(size_type count) {
+      if (count < _size) {
+        _destroy_range(_data, count, _size, indices{});
+      }
+      else if (count > _size) {
+        reserve(count);
+        _value_construct_range(_size, count, indices{});
+      }
+      _size = count;
+    }
+
+    void clear() noexcept {
+      _destroy_range(_data, 0, _size, indices{});
+      _size = 0;
+    }
+
+    void swap(soa_vector& other) noexcept {
+      std::swap(_data, other._data);
+      std::swap(_size, other._size);
+      std::swap(_capacity, other._capacity);
+    }
+  };
+}
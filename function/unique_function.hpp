@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef> // std::max_align_t, std::nullptr_t
+#include <functional> // std::invoke
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "./function.hpp" // function_settings
+
+namespace xlib {
+  // Move-only counterpart of xlib::function (like C++23 std::move_only_function). Because it
+  // is never copied, it can hold move-only callables such as lambdas owning a unique_ptr or a
+  // std::packaged_task. Callables of at most S::max_bytes_to_SOO bytes which are nothrow
+  // movable are stored in the object itself, so creating, moving and destroying one of them
+  // doesn't allocate; bigger ones go to the heap.
+  template <typename, typename = function_settings<true>>
+  class unique_function;
+
+  template <typename R, typename... Args, typename S>
+  class unique_function<R(Args...), S> {
+  private:
+    enum class types_of_actions {
+      move, clear
+    };
+
+    union storage_t {
+      void* heap;
+      alignas(std::max_align_t) char buffer[S::max_bytes_to_SOO > 0 ? S::max_bytes_to_SOO : 1];
+    };
+
+    template <typename F>
+    static constexpr bool is_local = S::is_enable_SOO
+      && sizeof(F) <= S::max_bytes_to_SOO
+      && alignof(F) <= alignof(std::max_align_t)
+      && std::is_nothrow_move_constructible_v<F>;
+
+    template <typename F>
+    static F* target(storage_t& storage) noexcept {
+      if constexpr (is_local<F>)
+        return std::launder(reinterpret_cast<F*>(storage.buffer));
+      else
+        return static_cast<F*>(storage.heap);
+    }
+
+    template <typename F>
+    static R invoke(storage_t& storage, Args&&... args) {
+      return std::invoke(*target<F>(storage), std::forward<Args>(args)...);
+    }
+
+    // Binds a call argument to the Arg&& parameter of invoke(). Only an lvalue of Arg itself
+    // (which Arg&& can't bind to) is copied here; anything else is passed on as is.
+    template <typename Arg, typename U>
+    static decltype(auto) pass(U&& arg) {
+      if constexpr (std::is_convertible_v<U&&, Arg&&>)
+        return std::forward<U>(arg);
+      else
+        return Arg(std::forward<U>(arg));
+    }
+
+    template <typename F>
+    static void manage(types_of_actions type, storage_t& storage, storage_t* other) noexcept {
+      switch (type) {
+        case types_of_actions::move:
+          if constexpr (is_local<F>) {
+            ::new (other->buffer) F(std::move(*target<F>(storage)));
+            target<F>(storage)->~F();
+          }
+          else {
+            other->heap = storage.heap;
+          }
+          return;
+
+        case types_of_actions::clear:
+          if constexpr (is_local<F>)
+            target<F>(storage)->~F();
+          else
+            delete target<F>(storage);
+          return;
+      }
+    }
+
+    using invoke_t = R (*)(storage_t&, Args&&...);
+    using manage_t = void (*)(types_of_actions, storage_t&, storage_t*) noexcept;
+
+    storage_t storage;
+    invoke_t invoke_f = nullptr;
+    manage_t manage_f = nullptr;
+
+    // Moves the callable of other into this empty function.
+    void take(unique_function& other) noexcept {
+      if (other.manage_f != nullptr) {
+        other.manage_f(types_of_actions::move, other.storage, &storage);
+        invoke_f = other.invoke_f;
+        manage_f = other.manage_f;
+        other.invoke_f = nullptr;
+        other.manage_f = nullptr;
+      }
+    }
+
+  public:
+    unique_function() noexcept = default;
+    unique_function(std::nullptr_t) noexcept {}
+
+    template <typename F>
+    requires (!std::is_same_v<unique_function, std::decay_t<F>> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+    unique_function(F&& f) {
+      using callable_t = std::decay_t<F>;
+
+      if constexpr (is_local<callable_t>)
+        ::new (storage.buffer) callable_t(std::forward<F>(f));
+      else
+        storage.heap = new callable_t(std::forward<F>(f));
+
+      invoke_f = &invoke<callable_t>;
+      manage_f = &manage<callable_t>;
+    }
+
+    unique_function(unique_function&& other) noexcept {
+      take(other);
+    }
+
+    unique_function& operator=(unique_function&& other) noexcept {
+      if (this != &other) {
+        clear();
+        take(other);
+      }
+      return *this;
+    }
+
+    unique_function(const unique_function&) = delete;
+    unique_function& operator=(const unique_function&) = delete;
+
+    ~unique_function() {
+      clear();
+    }
+
+    void clear() noexcept {
+      if (manage_f != nullptr) {
+        manage_f(types_of_actions::clear, storage, nullptr);
+        invoke_f = nullptr;
+        manage_f = nullptr;
+      }
+    }
+
+    explicit operator bool() const noexcept {
+      return invoke_f != nullptr;
+    }
+
+    // Arguments go by reference straight to the stored callable, so a by-value parameter is
+    // moved (or copied) once, not first into operator() and then again into the callable.
+    template <typename... CallArgs>
+    requires (sizeof...(CallArgs) == sizeof...(Args) && (std::is_convertible_v<CallArgs&&, Args> && ...))
+    R operator()(CallArgs&&... args) {
+      return invoke_f(storage, pass<Args>(std::forward<CallArgs>(args))...);
+    }
+  };
+}
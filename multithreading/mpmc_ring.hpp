@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <bit> // std::bit_ceil
+#include <cstddef> // std::size_t, std::ptrdiff_t, std::byte
+#include <memory> // std::unique_ptr, std::construct_at, std::destroy_at
+#include <type_traits>
+#include <utility> // std::forward, std::move, std::pair
+
+#include "../utility/cache_line.hpp"
+
+namespace xlib {
+  // Bounded lock-free queue for any number of producers and consumers (D. Vyukov's
+  // algorithm). Every slot carries a sequence number telling whose turn it is, so
+  // producers and consumers only contend on their own index and never on each other.
+  // The capacity is rounded up to a power of two.
+  //
+  // A claimed slot must always be handed on, or everybody waiting for it would spin forever.
+  // So values whose construction may throw are built before a slot is claimed and then moved
+  // in (T's move constructor must not throw), and a pop whose assignment to the output throws
+  // still frees the slots it claimed; the elements in them are dropped.
+  template <typename T>
+  class mpmc_ring {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "xlib::mpmc_ring: T must be nothrow move constructible");
+
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+  private:
+    struct cell {
+      std::atomic<size_type> sequence;
+      alignas(T) std::byte storage[sizeof(T)];
+
+      T* value() noexcept {
+        return reinterpret_cast<T*>(storage);
+      }
+    };
+
+    const size_type _mask;
+    const std::unique_ptr<cell[]> _cells;
+
+    alignas(cache_line_size) std::atomic<size_type> _enqueue_pos = 0;
+    alignas(cache_line_size) std::atomic<size_type> _dequeue_pos = 0;
+    char _padding[cache_line_size - sizeof(std::atomic<size_type>)];
+
+    // Claims up to count consecutive slots starting at the current position of index, where
+    // a slot is ready when its sequence equals position + lag. Returns the first claimed
+    // position and the number of claimed slots.
+    std::pair<size_type, size_type> _claim(std::atomic<size_type>& index, size_type count, size_type lag) noexcept {
+      size_type pos = index.load(std::memory_order_relaxed);
+      while (true) {
+        size_type ready = 0;
+        while (ready < count) {
+          size_type seq = _cells[(pos + ready) & _mask].sequence.load(std::memory_order_acquire);
+          if (seq != pos + ready + lag)
+            break;
+          ++ready;
+        }
+
+        if (ready == 0) {
+          size_type seq = _cells[pos & _mask].sequence.load(std::memory_order_acquire);
+          // The slot is still owned by the previous lap: the queue is full (or empty).
+          if (static_cast<std::ptrdiff_t>(seq - (pos + lag)) < 0)
+            return {pos, 0};
+          pos = index.load(std::memory_order_relaxed);
+          continue;
+        }
+
+        if (index.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed))
+          return {pos, ready};
+      }
+    }
+
+    // Destroys the element at the claimed position pos and hands the slot to the producers.
+    void _release(size_type pos) noexcept {
+      cell& c = _cells[pos & _mask];
+      std::destroy_at(c.value());
+      c.sequence.store(pos + _mask + 1, std::memory_order_release);
+    }
+
+  public:
+    explicit mpmc_ring(size_type capacity)
+        : _mask(std::bit_ceil(capacity < 2 ? size_type(2) : capacity) - 1)
+        , _cells(new cell[_mask + 1]) {
+      for (size_type i = 0; i <= _mask; ++i)
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    mpmc_ring(const mpmc_ring&) = delete;
+    mpmc_ring& operator=(const mpmc_ring&) = delete;
+
+    ~mpmc_ring() {
+      size_type enqueue = _enqueue_pos.load(std::memory_order_relaxed);
+      for (size_type i = _dequeue_pos.load(std::memory_order_relaxed); i != enqueue; ++i)
+        std::destroy_at(_cells[i & _mask].value());
+    }
+
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+      if constexpr (!std::is_nothrow_constructible_v<T, Args&&...>)
+        return try_emplace(T(std::forward<Args>(args)...));
+
+      auto [pos, count] = _claim(_enqueue_pos, 1, 0);
+      if (count == 0)
+        return false;
+
+      cell& c = _cells[pos & _mask];
+      std::construct_at(c.value(), std::forward<Args>(args)...);
+      c.sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool try_push(const T& value) { return try_emplace(value); }
+    bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+    // Claims up to count slots with a single CAS; returns how many elements were pushed.
+    // Elements whose construction may throw are pushed one by one instead.
+    template <typename InputIt>
+    size_type try_push_n(InputIt first, size_type count) {
+      if constexpr (!std::is_nothrow_constructible_v<T, decltype(*first)>) {
+        size_type pushed = 0;
+        for (; pushed < count && try_emplace(*first); ++pushed, ++first) {}
+        return pushed;
+      }
+
+      auto [pos, claimed] = _claim(_enqueue_pos, count, 0);
+
+      for (size_type i = 0; i < claimed; ++i, ++first) {
+        cell& c = _cells[(pos + i) & _mask];
+        std::construct_at(c.value(), *first);
+        c.sequence.store(pos + i + 1, std::memory_order_release);
+      }
+      return claimed;
+    }
+
+    bool try_pop(T& out) {
+      auto [pos, count] = _claim(_dequeue_pos, 1, 1);
+      if (count == 0)
+        return false;
+
+      try {
+        out = std::move(*_cells[pos & _mask].value());
+      }
+      catch (...) {
+        _release(pos);
+        throw;
+      }
+      _release(pos);
+      return true;
+    }
+
+    // Claims up to max_count slots with a single CAS; returns how many elements were popped.
+    template <typename OutputIt>
+    size_type try_pop_n(OutputIt out, size_type max_count) {
+      auto [pos, claimed] = _claim(_dequeue_pos, max_count, 1);
+
+      size_type i = 0;
+      try {
+        for (; i < claimed; ++i, ++out) {
+          *out = std::move(*_cells[(pos + i) & _mask].value());
+          _release(pos + i);
+        }
+      }
+      catch (...) {
+        for (; i < claimed; ++i)
+          _release(pos + i);
+        throw;
+      }
+      return claimed;
+    }
+
+    // Approximate when called concurrently.
+    size_type size() const noexcept {
+      size_type dequeue = _dequeue_pos.load(std::memory_order_acquire);
+      size_type enqueue = _enqueue_pos.load(std::memory_order_acquire);
+      return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+    size_type capacity() const noexcept { return _mask + 1; }
+  };
+}
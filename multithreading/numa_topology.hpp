@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm> // std::sort, std::unique, std::binary_search
+#include <cstddef> // std::size_t
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace xlib {
+  struct numa_node {
+    int id;
+    std::vector<int> cpus;
+  };
+
+  // Parses a Linux CPU list such as "0-3,8,10-11". Malformed parts are skipped.
+  inline std::vector<int> parse_cpu_list(std::string_view list) {
+    std::vector<int> cpus;
+
+    auto parse_number = [](std::string_view text, int& value) {
+      if (text.empty())
+        return false;
+      value = 0;
+      for (char c : text) {
+        if (c < '0' || c > '9')
+          return false;
+        value = value * 10 + (c - '0');
+      }
+      return true;
+    };
+
+    while (!list.empty()) {
+      std::size_t comma = list.find(',');
+      std::string_view part = list.substr(0, comma);
+      list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+      while (!part.empty() && (part.back() == '\n' || part.back() == ' '))
+        part.remove_suffix(1);
+
+      std::size_t dash = part.find('-');
+      int first = 0;
+      int last = 0;
+      if (dash == std::string_view::npos) {
+        if (!parse_number(part, first))
+          continue;
+        last = first;
+      }
+      else if (!parse_number(part.substr(0, dash), first) || !parse_number(part.substr(dash + 1), last) || last < first) {
+        continue;
+      }
+
+      for (int cpu = first; cpu <= last; ++cpu)
+        cpus.push_back(cpu);
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+  }
+
+  // CPUs the calling thread may run on (its affinity mask) on Linux. Elsewhere, or if that
+  // fails, CPUs 0..hardware_concurrency() - 1.
+  inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed))
+          cpus.push_back(cpu);
+      }
+    }
+#endif
+
+    if (cpus.empty()) {
+      unsigned count = std::thread::hardware_concurrency();
+      for (unsigned cpu = 0; cpu < (count != 0 ? count : 1); ++cpu)
+        cpus.push_back(static_cast<int>(cpu));
+    }
+
+    return cpus;
+  }
+
+  // NUMA nodes with the CPUs of each which the process may run on (nodes without such CPUs
+  // are left out), read from /sys/devices/system/node on Linux. Elsewhere, or if that fails,
+  // one node 0 with allowed_cpus().
+  inline std::vector<numa_node> numa_topology() {
+    std::vector<numa_node> nodes;
+    std::vector<int> allowed = allowed_cpus();
+
+#ifdef __linux__
+    std::vector<int> online;
+    {
+      std::ifstream file("/sys/devices/system/node/online");
+      std::string line;
+      if (std::getline(file, line))
+        online = parse_cpu_list(line); // same format as CPU lists
+    }
+
+    for (int id : online) {
+      std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+      std::string line;
+      if (!std::getline(file, line))
+        continue;
+
+      numa_node node{id, {}};
+      for (int cpu : parse_cpu_list(line)) {
+        if (std::binary_search(allowed.begin(), allowed.end(), cpu))
+          node.cpus.push_back(cpu);
+      }
+      if (!node.cpus.empty())
+        nodes.push_back(std::move(node));
+    }
+#endif
+
+    if (nodes.empty())
+      nodes.push_back(numa_node{0, std::move(allowed)});
+
+    return nodes;
+  }
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm> // std::sort, std::partition, std::min, std::max
+#include <atomic>
+#include <bit> // std::bit_width
+#include <cstddef> // std::size_t
+#include <exception> // std::exception_ptr
+#include <functional> // std::plus, std::less, std::invoke
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread> // std::this_thread::yield
+#include <utility>
+#include <vector>
+
+#include "./thread_pool.hpp"
+
+// Data-parallel algorithms on thread_pool. A range is cut into chunks of grain elements
+// (by default about 8 chunks per worker, so stealing can balance uneven chunks), and the
+// chunks are spread by recursive splitting: a task keeps the left half of its chunks and
+// posts the right half, which idle workers steal while it is still big. The calling
+// thread runs queued tasks while it waits, so the algorithms may be nested or called
+// from inside a task of the same pool. If an element function throws, the remaining
+// chunks still run and the first exception is rethrown to the caller.
+namespace xlib {
+  namespace detail {
+    // Counts tasks posted to a pool and waits for all of them, running queued tasks of the
+    // pool meanwhile.
+    class fork_join {
+    private:
+      thread_pool& pool;
+      std::atomic<std::size_t> pending = 0;
+      std::atomic<bool> failed = false;
+      std::mutex errorMutex;
+      std::exception_ptr error;
+
+      void record_error() noexcept {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (error == nullptr)
+          error = std::current_exception();
+        failed.store(true, std::memory_order_relaxed);
+      }
+
+    public:
+      explicit fork_join(thread_pool& pool) : pool(pool) {}
+
+      fork_join(const fork_join&) = delete;
+      fork_join& operator=(const fork_join&) = delete;
+
+      // f() may itself spawn on this fork_join.
+      template <typename F>
+      void spawn(F f) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        try {
+          pool.post([this, f = std::move(f)]() mutable noexcept {
+            run(f);
+            // the last access to *this: the waiting thread may destroy it right after
+            pending.fetch_sub(1, std::memory_order_release);
+          });
+        }
+        catch (...) {
+          pending.fetch_sub(1, std::memory_order_relaxed);
+          throw;
+        }
+      }
+
+      template <typename F>
+      void run(F& f) noexcept {
+        try {
+          f();
+        }
+        catch (...) {
+          record_error();
+        }
+      }
+
+      void wait() {
+        while (pending.load(std::memory_order_acquire) != 0) {
+          if (!pool.run_pending_task())
+            std::this_thread::yield();
+        }
+
+        if (failed.load(std::memory_order_relaxed))
+          std::rethrow_exception(error);
+      }
+    };
+
+    inline std::size_t auto_grain(const thread_pool& pool, std::size_t size, std::size_t min_grain = 1) {
+      std::size_t chunks = pool.size() * 8;
+      return std::max((size + chunks - 1) / chunks, min_grain);
+    }
+
+    // Calls body(begin, end) for every chunk [k * grain, min((k + 1) * grain, size)), in
+    // parallel. Chunk bounds depend only on size and grain, so reductions over chunks are
+    // deterministic.
+    template <typename Body>
+    void for_each_chunk(thread_pool& pool, std::size_t size, std::size_t grain, Body& body) {
+      if (size == 0)
+        return;
+
+      std::size_t chunk_count = (size + grain - 1) / grain;
+      auto run_chunks = [&](std::size_t first, std::size_t last) {
+        for (std::size_t k = first; k < last; ++k)
+          body(k * grain, std::min((k + 1) * grain, size));
+      };
+
+      if (chunk_count == 1) {
+        run_chunks(0, 1);
+        return;
+      }
+
+      fork_join join(pool);
+
+      struct splitter {
+        fork_join& join;
+        decltype(run_chunks)& run;
+
+        void operator()(std::size_t first, std::size_t last) const {
+          while (last - first > 1) {
+            std::size_t middle = first + (last - first) / 2;
+            join.spawn([this, middle, last] { (*this)(middle, last); });
+            last = middle;
+          }
+          run(first, last);
+        }
+      };
+
+      splitter split{join, run_chunks};
+      auto root = [&] { split(0, chunk_count); };
+      join.run(root);
+      join.wait();
+    }
+  }
+
+  // Calls f(i) for every i in [first, last).
+  // grain is the number of indices one task runs in a row; 0 picks it automatically.
+  template <typename Index, typename F>
+  requires std::is_integral_v<Index>
+  void parallel_for(thread_pool& pool, Index first, Index last, F&& f, std::size_t grain = 0) {
+    if (!(first < last))
+      return;
+
+    std::size_t size = static_cast<std::size_t>(last - first);
+    if (grain == 0)
+      grain = detail::auto_grain(pool, size);
+
+    auto body = [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i)
+        f(static_cast<Index>(first + static_cast<Index>(i)));
+    };
+    detail::for_each_chunk(pool, size, grain, body);
+  }
+
+  // Calls f(*it) for every it in [first, last).
+  template <std::random_access_iterator It, typename F>
+  void parallel_for_each(thread_pool& pool, It first, It last, F&& f, std::size_t grain = 0) {
+    parallel_for(pool, std::size_t(0), static_cast<std::size_t>(last - first),
+                 [&](std::size_t i) { f(first[i]); }, grain);
+  }
+
+  // reduce(init, transform(first[0]), transform(first[1]), ...) for an associative reduce;
+  // partial results are combined in order, so it needn't be commutative.
+  template <std::random_access_iterator It, typename T, typename Reduce, typename Transform>
+  T parallel_transform_reduce(thread_pool& pool, It first, It last, T init, Reduce reduce, Transform transform,
+                              std::size_t grain = 0) {
+    std::size_t size = static_cast<std::size_t>(last - first);
+    if (size == 0)
+      return init;
+    if (grain == 0)
+      grain = detail::auto_grain(pool, size);
+
+    std::vector<std::optional<T>> partials((size + grain - 1) / grain);
+    auto body = [&](std::size_t begin, std::size_t end) {
+      T partial = transform(first[begin]);
+      for (std::size_t i = begin + 1; i < end; ++i)
+        partial = reduce(std::move(partial), transform(first[i]));
+      partials[begin / grain].emplace(std::move(partial));
+    };
+    detail::for_each_chunk(pool, size, grain, body);
+
+    for (auto& partial : partials)
+      init = reduce(std::move(init), std::move(*partial));
+    return init;
+  }
+
+  template <std::random_access_iterator It, typename T, typename Reduce = std::plus<>>
+  T parallel_reduce(thread_pool& pool, It first, It last, T init, Reduce reduce = Reduce(), std::size_t grain = 0) {
+    return parallel_transform_reduce(pool, first, last, std::move(init), reduce,
+                                     [](const auto& value) -> T { return value; }, grain);
+  }
+
+  // Inclusive prefix scan: out[i] = first[0] op first[1] op ... op first[i] for an
+  // associative op. Two passes: the chunk totals are computed in parallel and scanned
+  // serially, then every chunk is scanned starting from the total of the chunks before it.
+  // out may be first. Returns the end of the output.
+  template <std::random_access_iterator It, std::random_access_iterator Out, typename Op = std::plus<>>
+  Out parallel_scan(thread_pool& pool, It first, It last, Out out, Op op = Op(), std::size_t grain = 0) {
+    using value_t = std::iter_value_t<It>;
+
+    std::size_t size = static_cast<std::size_t>(last - first);
+    if (size == 0)
+      return out;
+    if (grain == 0)
+      grain = detail::auto_grain(pool, size);
+
+    std::size_t chunk_count = (size + grain - 1) / grain;
+    std::vector<std::optional<value_t>> carries(chunk_count);
+
+    auto sum = [&](std::size_t begin, std::size_t end) {
+      value_t total = first[begin];
+      for (std::size_t i = begin + 1; i < end; ++i)
+        total = op(std::move(total), first[i]);
+      carries[begin / grain].emplace(std::move(total));
+    };
+    // the last chunk's total isn't needed
+    detail::for_each_chunk(pool, (chunk_count - 1) * grain, grain, sum);
+
+    // carries[k] becomes the total of all chunks before k
+    std::optional<value_t> running;
+    for (auto& carry : carries) {
+      std::optional<value_t> total = std::move(carry);
+      carry = running;
+      if (total.has_value())
+        running = running.has_value() ? op(std::move(*running), std::move(*total)) : std::move(*total);
+    }
+
+    auto scan = [&](std::size_t begin, std::size_t end) {
+      const std::optional<value_t>& carry = carries[begin / grain];
+      value_t running = carry.has_value() ? op(*carry, first[begin]) : value_t(first[begin]);
+      out[begin] = running;
+      for (std::size_t i = begin + 1; i < end; ++i) {
+        running = op(std::move(running), first[i]);
+        out[i] = running;
+      }
+    };
+    detail::for_each_chunk(pool, size, grain, scan);
+
+    return out + static_cast<std::iter_difference_t<Out>>(size);
+  }
+
+  // Parallel quicksort: a range is split three ways around a median-of-three pivot and the
+  // two outer parts are sorted by separate tasks, down to grain elements, which are sorted
+  // with std::sort. After 2 * log2(n) levels of splitting a range is std::sort-ed too, so
+  // bad pivots can't make it quadratic. Not stable.
+  template <std::random_access_iterator It, typename Compare = std::less<>>
+  void parallel_sort(thread_pool& pool, It first, It last, Compare comp = Compare(), std::size_t grain = 0) {
+    std::size_t size = static_cast<std::size_t>(last - first);
+    if (size < 2)
+      return;
+    if (grain == 0)
+      grain = detail::auto_grain(pool, size, 2048);
+    if (size <= grain) {
+      std::sort(first, last, comp);
+      return;
+    }
+
+    using value_t = std::iter_value_t<It>;
+
+    detail::fork_join join(pool);
+
+    struct sorter {
+      detail::fork_join& join;
+      Compare& comp;
+      std::size_t grain;
+
+      void operator()(It first, It last, std::size_t depth) const {
+        while (static_cast<std::size_t>(last - first) > grain) {
+          if (depth == 0) {
+            std::sort(first, last, comp);
+            return;
+          }
+          --depth;
+
+          It middle = first + (last - first) / 2;
+          value_t pivot = median(first[0], *middle, last[-1]);
+
+          It equal = std::partition(first, last, [&](const auto& value) { return comp(value, pivot); });
+          It greater = std::partition(equal, last, [&](const auto& value) { return !comp(pivot, value); });
+
+          // sort the smaller part in a new task, continue with the bigger one
+          if (equal - first < last - greater) {
+            join.spawn([this, first, equal, depth] { (*this)(first, equal, depth); });
+            first = greater;
+          }
+          else {
+            join.spawn([this, greater, last, depth] { (*this)(greater, last, depth); });
+            last = equal;
+          }
+        }
+        std::sort(first, last, comp);
+      }
+
+      value_t median(const value_t& a, const value_t& b, const value_t& c) const {
+        if (comp(a, b))
+          return comp(b, c) ? b : (comp(a, c) ? c : a);
+        return comp(a, c) ? a : (comp(b, c) ? c : b);
+      }
+    };
+
+    sorter sort{join, comp, grain};
+    auto root = [&] { sort(first, last, 2 * static_cast<std::size_t>(std::bit_width(size))); };
+    join.run(root);
+    join.wait();
+  }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef> // std::size_t, std::byte
+#include <memory> // std::construct_at, std::destroy_at
+#include <utility> // std::forward, std::move
+
+#include "../utility/cache_line.hpp"
+
+namespace xlib {
+  // Bounded wait-free queue for exactly one producer thread and one consumer thread.
+  // N must be a power of two. Every index lives on its own cache line, and each side
+  // keeps a cached copy of the other side's index, so the shared lines are only read
+  // when the queue looks full (producer) or empty (consumer).
+  template <typename T, std::size_t N>
+  class spsc_ring {
+    static_assert(N != 0 && (N & (N - 1)) == 0, "xlib::spsc_ring: N must be a power of two");
+
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+  private:
+    static constexpr size_type mask = N - 1;
+
+    alignas(cache_line_size) std::atomic<size_type> _head = 0; // next index to pop
+    alignas(cache_line_size) size_type _cached_tail = 0;       // consumer's copy of _tail
+
+    alignas(cache_line_size) std::atomic<size_type> _tail = 0; // next index to push
+    alignas(cache_line_size) size_type _cached_head = 0;       // producer's copy of _head
+
+    alignas(cache_line_size) std::byte _storage[sizeof(T) * N];
+
+    T* _slot(size_type index) noexcept {
+      return reinterpret_cast<T*>(_storage) + (index & mask);
+    }
+
+    // Free slots as seen by the producer, refreshing _cached_head only if needed.
+    size_type _free_slots(size_type tail, size_type wanted) noexcept {
+      size_type free = N - (tail - _cached_head);
+      if (free < wanted) {
+        _cached_head = _head.load(std::memory_order_acquire);
+        free = N - (tail - _cached_head);
+      }
+      return free;
+    }
+
+    // Ready elements as seen by the consumer, refreshing _cached_tail only if needed.
+    size_type _ready_slots(size_type head, size_type wanted) noexcept {
+      size_type ready = _cached_tail - head;
+      if (ready < wanted) {
+        _cached_tail = _tail.load(std::memory_order_acquire);
+        ready = _cached_tail - head;
+      }
+      return ready;
+    }
+
+  public:
+    spsc_ring() = default;
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    ~spsc_ring() {
+      size_type tail = _tail.load(std::memory_order_relaxed);
+      for (size_type i = _head.load(std::memory_order_relaxed); i != tail; ++i)
+        std::destroy_at(_slot(i));
+    }
+
+    // Producer side.
+
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+      size_type tail = _tail.load(std::memory_order_relaxed);
+      if (_free_slots(tail, 1) == 0)
+        return false;
+
+      std::construct_at(_slot(tail), std::forward<Args>(args)...);
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool try_push(const T& value) { return try_emplace(value); }
+    bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+    // Pushes up to count elements from first with a single publication; returns how many were pushed.
+    template <typename InputIt>
+    size_type try_push_n(InputIt first, size_type count) {
+      size_type tail = _tail.load(std::memory_order_relaxed);
+      size_type free = _free_slots(tail, count);
+      if (count > free)
+        count = free;
+
+      // nothing is published if an element throws, so destroy the ones already built
+      size_type built = 0;
+      try {
+        for (; built < count; ++built, ++first)
+          std::construct_at(_slot(tail + built), *first);
+      }
+      catch (...) {
+        for (size_type i = 0; i < built; ++i)
+          std::destroy_at(_slot(tail + i));
+        throw;
+      }
+
+      if (count != 0)
+        _tail.store(tail + count, std::memory_order_release);
+      return count;
+    }
+
+    // Consumer side.
+
+    bool try_pop(T& out) {
+      size_type head = _head.load(std::memory_order_relaxed);
+      if (_ready_slots(head, 1) == 0)
+        return false;
+
+      T* slot = _slot(head);
+      out = std::move(*slot);
+      std::destroy_at(slot);
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Pops up to max_count elements into out with a single release of the slots; returns how many were popped.
+    template <typename OutputIt>
+    size_type try_pop_n(OutputIt out, size_type max_count) {
+      size_type head = _head.load(std::memory_order_relaxed);
+      size_type count = _ready_slots(head, max_count);
+      if (count > max_count)
+        count = max_count;
+
+      for (size_type i = 0; i < count; ++i, ++out) {
+        T* slot = _slot(head + i);
+        *out = std::move(*slot);
+        std::destroy_at(slot);
+      }
+
+      if (count != 0)
+        _head.store(head + count, std::memory_order_release);
+      return count;
+    }
+
+    // Consumer side only; the element stays in the queue.
+    T* front() {
+      size_type head = _head.load(std::memory_order_relaxed);
+      return _ready_slots(head, 1) == 0 ? nullptr : _slot(head);
+    }
+
+    // Approximate when called concurrently with the other side.
+    size_type size() const noexcept {
+      size_type head = _head.load(std::memory_order_acquire);
+      return _tail.load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+    static constexpr size_type capacity() noexcept { return N; }
+  };
+}
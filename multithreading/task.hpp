@@ -0,0 +1,499 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef> // std::size_t, std::max_align_t
+#include <exception> // std::exception_ptr, std::terminate
+#include <memory> // std::shared_ptr
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <stdexcept> // std::invalid_argument
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant> // std::monostate
+#include <vector>
+
+#include "./thread_pool.hpp"
+#include "../allocators/memory_resource/size_class_memory_resource.hpp"
+
+// Coroutines on thread_pool:
+//
+//   xlib::task<int> parse(std::string text) {
+//     co_await xlib::schedule_on(pool); // continue on a worker
+//     co_return compute(text);
+//   }
+//
+//   xlib::task<int> both() {
+//     auto [a, b] = co_await xlib::when_all(parse(x), parse(y));
+//     co_return a + b;
+//   }
+//
+//   int result = xlib::sync_wait(both());
+//
+// A task is lazy: it starts when it is awaited and runs on the awaiting thread until it
+// suspends, and its awaiter continues on the thread which completes it. A task which
+// completes before it suspends lets its awaiter go on without suspending at all, so loops
+// over such tasks don't grow the stack (this doesn't rely on the compiler turning symmetric
+// transfer into tail calls, which GCC doesn't do without optimization). Coroutine frames
+// come from a shared thread-safe size_class_memory_resource instead of the global heap.
+namespace xlib {
+  template <typename T = void>
+  class task;
+
+  // Result type of awaiting a task<T> inside when_all/when_any: T, or std::monostate for void.
+  template <typename T>
+  using task_result_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+  namespace detail {
+    // Base of the promise types: frames are allocated from pooled size classes.
+    struct frame_allocation {
+      static std::pmr::memory_resource& frame_resource() {
+        // never destroyed: detached coroutines may finish after static destruction began
+        static auto* resource = new size_class_memory_resource<thread_safety<true>>(std::pmr::new_delete_resource());
+        return *resource;
+      }
+
+      static void* operator new(std::size_t size) {
+        return frame_resource().allocate(size, alignof(std::max_align_t));
+      }
+
+      static void operator delete(void* ptr, std::size_t size) noexcept {
+        frame_resource().deallocate(ptr, size, alignof(std::max_align_t));
+      }
+    };
+
+    template <typename T>
+    class task_promise_result {
+    private:
+      std::variant<std::monostate, T, std::exception_ptr> result;
+
+    public:
+      template <typename U>
+      void return_value(U&& value) {
+        result.template emplace<1>(std::forward<U>(value));
+      }
+
+      void unhandled_exception() noexcept {
+        result.template emplace<2>(std::current_exception());
+      }
+
+      T take() {
+        if (result.index() == 2)
+          std::rethrow_exception(std::get<2>(result));
+        return std::move(std::get<1>(result));
+      }
+    };
+
+    template <>
+    class task_promise_result<void> {
+    private:
+      std::exception_ptr error;
+
+    public:
+      void return_void() noexcept {}
+
+      void unhandled_exception() noexcept {
+        error = std::current_exception();
+      }
+
+      void take() {
+        if (error != nullptr)
+          std::rethrow_exception(error);
+      }
+    };
+
+    // Takes the result of a finished promise as task_result_t<T>.
+    template <typename T, typename Promise>
+    task_result_t<T> take_result(Promise& promise) {
+      if constexpr (std::is_void_v<T>) {
+        promise.take();
+        return {};
+      }
+      else {
+        return promise.take();
+      }
+    }
+
+    // Coroutine which is started by hand and destroys itself when it finishes.
+    struct detached {
+      struct promise_type : frame_allocation {
+        detached get_return_object() noexcept { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+      };
+
+      std::coroutine_handle<promise_type> handle;
+
+      void start() { handle.resume(); }
+    };
+
+    // Joins a coroutine with children it started: count is the number of children plus one
+    // for the parent, so the parent is resumed by whichever of it and the last child is later.
+    struct join_counter {
+      std::atomic<std::size_t> count;
+      std::coroutine_handle<> parent;
+
+      explicit join_counter(std::size_t children) : count(children + 1) {}
+
+      // Called by a finished child; returns the coroutine to continue with.
+      std::coroutine_handle<> notify() noexcept {
+        if (count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+          return parent;
+        return std::noop_coroutine();
+      }
+    };
+
+    // Suspends the parent, runs start() to start the children, and resumes the parent
+    // when all children have notified the counter (at once, if they already have).
+    template <typename Start>
+    struct join_awaiter {
+      join_counter& counter;
+      Start start;
+
+      bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(std::coroutine_handle<> parent) {
+        counter.parent = parent;
+        start();
+        return counter.count.fetch_sub(1, std::memory_order_acq_rel) != 1;
+      }
+
+      void await_resume() const noexcept {}
+    };
+
+    template <typename T>
+    class when_all_child {
+    public:
+      struct promise_type : frame_allocation, task_promise_result<T> {
+        join_counter* counter = nullptr;
+
+        when_all_child get_return_object() noexcept {
+          return when_all_child(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        auto final_suspend() noexcept {
+          struct awaiter {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) noexcept {
+              return self.promise().counter->notify();
+            }
+            void await_resume() const noexcept {}
+          };
+          return awaiter{};
+        }
+      };
+
+    private:
+      std::coroutine_handle<promise_type> handle;
+
+      explicit when_all_child(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+
+    public:
+      when_all_child(when_all_child&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+      when_all_child& operator=(when_all_child&&) = delete;
+
+      ~when_all_child() {
+        if (handle)
+          handle.destroy();
+      }
+
+      void start(join_counter& counter) {
+        handle.promise().counter = &counter;
+        handle.resume();
+      }
+
+      task_result_t<T> result() {
+        return take_result<T>(handle.promise());
+      }
+    };
+
+    template <typename T>
+    requires (!std::is_void_v<T>)
+    when_all_child<T> make_when_all_child(task<T> t) {
+      co_return co_await std::move(t);
+    }
+
+    template <typename T>
+    requires std::is_void_v<T>
+    when_all_child<T> make_when_all_child(task<T> t) {
+      co_await std::move(t);
+    }
+
+    template <typename T>
+    struct when_any_state {
+      join_counter counter{1}; // the parent and the winner
+      std::atomic<bool> finished = false;
+      std::size_t index = 0;
+      std::optional<task_result_t<T>> value;
+      std::exception_ptr error;
+    };
+
+    template <typename T>
+    detached when_any_child(std::shared_ptr<when_any_state<T>> state, task<T> t, std::size_t index) {
+      std::optional<task_result_t<T>> value;
+      std::exception_ptr error;
+      try {
+        if constexpr (std::is_void_v<T>) {
+          co_await std::move(t);
+          value.emplace();
+        }
+        else {
+          value.emplace(co_await std::move(t));
+        }
+      }
+      catch (...) {
+        error = std::current_exception();
+      }
+
+      if (!state->finished.exchange(true, std::memory_order_acq_rel)) {
+        state->index = index;
+        state->value = std::move(value);
+        state->error = error;
+        state->counter.notify().resume();
+      }
+    }
+
+    struct sync_wait_state {
+      std::mutex mutex;
+      std::condition_variable finished;
+      bool done = false;
+    };
+
+    template <typename T>
+    detached sync_wait_body(task<T>& t, std::optional<task_result_t<T>>& value, std::exception_ptr& error,
+                            sync_wait_state& state) {
+      try {
+        if constexpr (std::is_void_v<T>) {
+          co_await std::move(t);
+          value.emplace();
+        }
+        else {
+          value.emplace(co_await std::move(t));
+        }
+      }
+      catch (...) {
+        error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.done = true;
+      state.finished.notify_one();
+    }
+  }
+
+  // Lazily started coroutine producing a T (or an exception). Move-only; destroying a task
+  // which hasn't finished destroys its coroutine.
+  template <typename T>
+  class [[nodiscard]] task {
+    static_assert(!std::is_reference_v<T>, "xlib::task: T must not be a reference");
+
+  public:
+    struct promise_type : detail::frame_allocation, detail::task_promise_result<T> {
+      std::coroutine_handle<> continuation;
+      // Set by whichever of the awaiter (after the task first suspended) and the finished
+      // task comes first; the second one knows the awaiter has to be resumed by the task.
+      std::atomic<bool> handoff = false;
+
+      task get_return_object() noexcept {
+        return task(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+
+      std::suspend_always initial_suspend() noexcept { return {}; }
+
+      auto final_suspend() noexcept {
+        struct awaiter {
+          bool await_ready() const noexcept { return false; }
+          void await_suspend(std::coroutine_handle<promise_type> self) noexcept {
+            promise_type& promise = self.promise();
+            if (promise.handoff.exchange(true, std::memory_order_acq_rel))
+              promise.continuation.resume();
+          }
+          void await_resume() const noexcept {}
+        };
+        return awaiter{};
+      }
+    };
+
+  private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+
+    struct awaiter {
+      std::coroutine_handle<promise_type> handle;
+
+      bool await_ready() const noexcept {
+        return handle.done();
+      }
+
+      // Runs the task until it suspends; returns false (don't suspend) if it has finished.
+      bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        promise_type& promise = handle.promise();
+        handle.resume();
+        promise.continuation = awaiting;
+        return !promise.handoff.exchange(true, std::memory_order_acq_rel);
+      }
+
+      T await_resume() {
+        return handle.promise().take();
+      }
+    };
+
+  public:
+    task() noexcept = default;
+
+    task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    task& operator=(task&& other) noexcept {
+      if (this != &other) {
+        if (handle)
+          handle.destroy();
+        handle = std::exchange(other.handle, nullptr);
+      }
+      return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task() {
+      if (handle)
+        handle.destroy();
+    }
+
+    // A default-constructed or moved-from task must not be awaited.
+    bool valid() const noexcept {
+      return static_cast<bool>(handle);
+    }
+
+    awaiter operator co_await() & noexcept { return {handle}; }
+    awaiter operator co_await() && noexcept { return {handle}; }
+  };
+
+  // co_await schedule_on(pool) continues the coroutine on a worker of pool.
+  struct schedule_awaiter {
+    thread_pool& pool;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      pool.post([handle]() noexcept { handle.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  inline schedule_awaiter schedule_on(thread_pool& pool) noexcept {
+    return {pool};
+  }
+
+  // Runs t on the calling thread until it suspends and blocks until it finishes. For code
+  // outside coroutines (e.g. main); calling it from a worker of the pool the task waits for
+  // may deadlock.
+  template <typename T>
+  T sync_wait(task<T> t) {
+    std::optional<task_result_t<T>> value;
+    std::exception_ptr error;
+    detail::sync_wait_state state;
+
+    detail::sync_wait_body(t, value, error, state).start();
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.finished.wait(lock, [&] { return state.done; });
+
+    if (error != nullptr)
+      std::rethrow_exception(error);
+    if constexpr (!std::is_void_v<T>)
+      return std::move(*value);
+  }
+
+  // Awaits all tasks and returns their results in order; void results are std::monostate.
+  // The tasks are started one after another on the awaiting thread, each running until it
+  // first suspends, so they run in parallel if they co_await schedule_on(pool). If tasks
+  // throw, the exception of the first of them is rethrown after all have finished.
+  template <typename... T>
+  task<std::tuple<task_result_t<T>...>> when_all(task<T>... tasks) {
+    std::tuple<detail::when_all_child<T>...> children(detail::make_when_all_child(std::move(tasks))...);
+    detail::join_counter counter(sizeof...(T));
+
+    auto start = [&] {
+      std::apply([&](auto&... child) { (child.start(counter), ...); }, children);
+    };
+    co_await detail::join_awaiter<decltype(start)>{counter, start};
+
+    co_return std::apply([](auto&... child) {
+      // braced initialization evaluates the results in order
+      return std::tuple<task_result_t<T>...>{child.result()...};
+    }, children);
+  }
+
+  template <typename T>
+  task<std::vector<task_result_t<T>>> when_all(std::vector<task<T>> tasks) {
+    std::vector<detail::when_all_child<T>> children;
+    children.reserve(tasks.size());
+    for (task<T>& t : tasks)
+      children.push_back(detail::make_when_all_child(std::move(t)));
+    detail::join_counter counter(children.size());
+
+    auto start = [&] {
+      for (auto& child : children)
+        child.start(counter);
+    };
+    co_await detail::join_awaiter<decltype(start)>{counter, start};
+
+    std::vector<task_result_t<T>> results;
+    results.reserve(children.size());
+    for (auto& child : children)
+      results.push_back(child.result());
+    co_return results;
+  }
+
+  template <typename T>
+  struct when_any_result {
+    std::size_t index;
+    task_result_t<T> value;
+  };
+
+  // Awaits the first of tasks to finish and returns its index and result (or rethrows its
+  // exception). Tasks are started one after another like in when_all, but no more are
+  // started once one has finished. The others are not cancelled: they run to completion in
+  // the background and their results are dropped, so they must not refer to anything which
+  // may be gone by then.
+  template <typename T>
+  task<when_any_result<T>> when_any(std::vector<task<T>> tasks) {
+    if (tasks.empty())
+      throw std::invalid_argument("xlib::when_any: no tasks");
+
+    auto state = std::make_shared<detail::when_any_state<T>>();
+
+    auto start = [&] {
+      for (std::size_t i = 0; i < tasks.size(); ++i) {
+        if (state->finished.load(std::memory_order_acquire))
+          break;
+        detail::when_any_child(state, std::move(tasks[i]), i).start();
+      }
+    };
+    co_await detail::join_awaiter<decltype(start)>{state->counter, start};
+
+    if (state->error != nullptr)
+      std::rethrow_exception(state->error);
+    co_return when_any_result<T>{state->index, std::move(*state->value)};
+  }
+
+  template <typename T, typename... Rest>
+  requires (std::is_same_v<task<T>, Rest> && ...)
+  task<when_any_result<T>> when_any(task<T> first, Rest... rest) {
+    std::vector<task<T>> tasks;
+    tasks.reserve(1 + sizeof...(Rest));
+    tasks.push_back(std::move(first));
+    (tasks.push_back(std::move(rest)), ...);
+    return when_any(std::move(tasks));
+  }
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef> // std::size_t
+#include <deque>
+#include <exception> // std::exception_ptr
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept> // std::logic_error, std::out_of_range
+#include <thread> // std::this_thread::yield
+#include <utility>
+#include <vector>
+
+#include "./thread_pool.hpp"
+#include "../function/unique_function.hpp"
+
+namespace xlib {
+  // Directed acyclic graph of tasks run on a thread_pool. Every task counts its unfinished
+  // predecessors; the task which finishes last posts it (or runs it right away, if it is
+  // the only one it released), so no task is queued before it can run and no worker ever
+  // waits for another task:
+  //
+  //   xlib::task_graph graph;
+  //   auto load = graph.add([] { ... });
+  //   auto parse = graph.add([] { ... }, {load});
+  //   auto index = graph.add([] { ... }, {load});
+  //   graph.add([] { ... }, {parse, index});
+  //   graph.run(pool);
+  //
+  // run() waits for the whole graph, running queued tasks of the pool meanwhile, so it may
+  // also be called from inside a task. start() returns at once and calls a completion
+  // function on the thread which finishes the last task. If a task throws, the tasks which
+  // haven't started yet are skipped and the first exception is reported.
+  //
+  // A graph may be run any number of times, but not concurrently, and must not be changed
+  // while it runs.
+  class task_graph {
+  public:
+    using task_id = std::size_t;
+
+  private:
+    struct node {
+      unique_function<void()> work;
+      std::vector<task_id> successors;
+      std::size_t dependencies = 0;
+      std::atomic<std::size_t> remaining = 0;
+
+      template <typename F>
+      explicit node(F&& f) : work(std::forward<F>(f)) {}
+    };
+
+    std::deque<node> nodes;
+
+    thread_pool* pool = nullptr;
+    std::atomic<std::size_t> pending = 0;
+    std::atomic<bool> failed = false;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    unique_function<void(std::exception_ptr)> completion;
+
+    void check_id(task_id id) const {
+      if (id >= nodes.size())
+        throw std::out_of_range("xlib::task_graph: unknown task");
+    }
+
+    // Kahn's algorithm: every task is reachable from the roots only if there is no cycle.
+    void check_acyclic() const {
+      std::vector<std::size_t> remaining(nodes.size());
+      std::vector<task_id> ready;
+      for (task_id id = 0; id < nodes.size(); ++id) {
+        remaining[id] = nodes[id].dependencies;
+        if (remaining[id] == 0)
+          ready.push_back(id);
+      }
+
+      std::size_t visited = 0;
+      while (!ready.empty()) {
+        task_id id = ready.back();
+        ready.pop_back();
+        ++visited;
+        for (task_id successor : nodes[id].successors) {
+          if (--remaining[successor] == 0)
+            ready.push_back(successor);
+        }
+      }
+
+      if (visited != nodes.size())
+        throw std::logic_error("xlib::task_graph: the graph has a cycle");
+    }
+
+    void prepare(thread_pool& pool) {
+      check_acyclic();
+
+      this->pool = &pool;
+      failed.store(false, std::memory_order_relaxed);
+      error = nullptr;
+      for (node& n : nodes)
+        n.remaining.store(n.dependencies, std::memory_order_relaxed);
+      pending.store(nodes.size(), std::memory_order_relaxed);
+    }
+
+    void post_roots() {
+      // collected first: a root may finish and release its successors while we post
+      std::vector<task_id> roots;
+      for (task_id id = 0; id < nodes.size(); ++id) {
+        if (nodes[id].dependencies == 0)
+          roots.push_back(id);
+      }
+      for (task_id id : roots)
+        post(id);
+    }
+
+    void post(task_id id) {
+      pool->post([this, id]() noexcept { run_from(id); });
+    }
+
+    // Runs the task and then, as long as it releases exactly one successor, that successor.
+    void run_from(task_id id) noexcept {
+      while (true) {
+        node& n = nodes[id];
+        if (!failed.load(std::memory_order_relaxed)) {
+          try {
+            n.work();
+          }
+          catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (error == nullptr)
+              error = std::current_exception();
+            failed.store(true, std::memory_order_relaxed);
+          }
+        }
+
+        constexpr task_id none = static_cast<task_id>(-1);
+        task_id next = none;
+        for (task_id successor : n.successors) {
+          if (nodes[successor].remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            continue;
+          if (next != none)
+            post(next);
+          next = successor;
+        }
+
+        finish_one();
+        if (next == none)
+          return;
+        id = next;
+      }
+    }
+
+    void finish_one() noexcept {
+      // read before the decrement: after the last one, run() may return and destroy the graph
+      bool notify = static_cast<bool>(completion);
+      if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1 && notify) {
+        auto done = std::move(completion);
+        done(error);
+      }
+    }
+
+  public:
+    task_graph() = default;
+
+    task_graph(const task_graph&) = delete;
+    task_graph& operator=(const task_graph&) = delete;
+
+    // Adds a task which runs f() once all tasks in after have finished.
+    template <typename F>
+    task_id add(F&& f, std::initializer_list<task_id> after = {}) {
+      for (task_id before : after)
+        check_id(before);
+
+      nodes.emplace_back(std::forward<F>(f));
+      task_id id = nodes.size() - 1;
+      for (task_id before : after)
+        precede(before, id);
+      return id;
+    }
+
+    // Makes after wait for before.
+    void precede(task_id before, task_id after) {
+      check_id(before);
+      check_id(after);
+      nodes[before].successors.push_back(after);
+      ++nodes[after].dependencies;
+    }
+
+    std::size_t size() const noexcept {
+      return nodes.size();
+    }
+
+    // Runs the graph and waits for it, running tasks of the pool meanwhile. Rethrows the
+    // first exception of a task; throws std::logic_error if the graph has a cycle.
+    void run(thread_pool& pool) {
+      prepare(pool);
+      completion = nullptr;
+      post_roots();
+
+      while (pending.load(std::memory_order_acquire) != 0) {
+        if (!pool.run_pending_task())
+          std::this_thread::yield();
+      }
+
+      if (failed.load(std::memory_order_relaxed))
+        std::rethrow_exception(error);
+    }
+
+    // Starts the graph and returns. done(std::exception_ptr) is called once all tasks have
+    // finished, with the first exception of a task or nullptr; the graph must live until then.
+    // Throws std::logic_error if the graph has a cycle.
+    template <typename F>
+    void start(thread_pool& pool, F&& done) {
+      prepare(pool);
+      if (nodes.empty()) {
+        done(std::exception_ptr());
+        return;
+      }
+
+      completion = std::forward<F>(done);
+      post_roots();
+    }
+  };
+}
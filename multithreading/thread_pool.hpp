@@ -1,92 +1,519 @@
 #pragma once
 
+#include <algorithm> // std::max, std::min
 #include <vector>
 #include <thread>
-#include <queue>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <future>
+#include <cstdint>
+#include <stdexcept> // std::invalid_argument, std::logic_error
+#include <string>
+#include <type_traits>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "./numa_topology.hpp"
+#include "./work_stealing_deque.hpp"
+#include "../utility/cache_line.hpp"
+#include "../allocators/pool_allocator.hpp"
+#include "../function/unique_function.hpp"
 
 namespace xlib {
+  enum class worker_placement {
+    // Workers aren't pinned (unless thread_pool_options::cpus says so) and form one group.
+    none,
+    // Workers are spread over the NUMA nodes in contiguous blocks and each may run on any
+    // CPU of its node.
+    numa_nodes,
+    // Like numa_nodes, but every worker is pinned to one CPU of its node.
+    cores,
+  };
+
+  struct thread_pool_options {
+    // Number of workers; 0 means one per hardware thread.
+    std::size_t threads = 0;
+    // Workers are named "<name>-<index>" (cut to the 15 characters Linux allows).
+    std::string name = "xlib-worker";
+    // CPUs to pin the workers to: worker i runs on cpus[i % cpus.size()], in the group of
+    // the NUMA node of that CPU. Overrides placement. Naming and pinning are done on Linux only.
+    std::vector<int> cpus;
+    worker_placement placement = worker_placement::none;
+  };
+
+  // Work-stealing thread pool. Every worker owns a Chase-Lev deque: tasks submitted from a
+  // worker go to the bottom of its own deque and are run by it LIFO, which keeps recursive
+  // work cache-hot and needs no lock. Tasks submitted from other threads go to a shared
+  // injection queue. An idle worker takes from its own deque, then from the injection queue,
+  // then steals the oldest task of other workers, starting at a random victim; only when all
+  // of that fails does it sleep. The destructor runs all queued tasks before joining.
+  //
+  // With a worker_placement other than none (or explicit cpus) the workers are grouped by
+  // NUMA node, and idle workers look for work on their own node first: its injection queue,
+  // then the deques of its workers, and only then elsewhere. post_on_node() and
+  // enqueue_on_node() queue a task on a node, so it preferentially runs there, near memory
+  // which its workers touched first (or which was bound to the node, see
+  // huge_page_memory_resource). Workers of other nodes still take it rather than stay idle.
+  //
+  // Tasks are stored in unique_function with room for task_buffer_size bytes of captures, in
+  // nodes taken from a thread-safe pool_allocator, so post() of a small callable doesn't
+  // touch the heap at all. enqueue() additionally allocates the shared state of its future.
   class thread_pool {
   public:
-    thread_pool(size_t numThreads) : stop(false) {
-      auto loop_of_work = [this] {
-        auto get_task = [this](std::function<void()>& task) {
-          std::unique_lock<std::mutex> lock(queueMutex);
-
-          condition.wait(lock, [this] {
-            return stop || !tasks.empty();
-          });
-
-          if (stop && tasks.empty()) {
-            condition.notify_all();
-            return false;
-          }
+    static constexpr size_t task_buffer_size = 48;
+
+  private:
+    using task_t = unique_function<void(), function_settings<true, task_buffer_size>>;
+    using task_allocator_t = pool_allocator<task_t, thread_safety<true>>;
 
-          task = std::move(tasks.front());
-          tasks.pop();
+    struct worker_t {
+      work_stealing_deque<task_t*> tasks;
+      std::uint64_t rng;
+      size_t node = 0;
+      std::vector<int> cpus; // empty: not pinned
+    };
 
-          return true;
-        };
+    struct alignas(cache_line_size) injection_queue {
+      std::mutex mutex;
+      std::deque<task_t*> tasks;
+      std::atomic<size_t> size = 0;
+
+      void push(task_t* task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(task);
+        size.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      task_t* pop() {
+        if (size.load(std::memory_order_relaxed) == 0)
+          return nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty())
+          return nullptr;
+
+        task_t* task = tasks.front();
+        tasks.pop_front();
+        size.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+      }
+
+      bool empty() const noexcept {
+        return size.load(std::memory_order_relaxed) == 0;
+      }
+    };
+
+    // thread_local, so zero-initialized: no pool
+    struct worker_context {
+      thread_pool* pool;
+      std::size_t index;
+    };
+
+    static inline thread_local worker_context current_worker;
+
+    static thread_pool_options options_with_threads(size_t threads) {
+      thread_pool_options options;
+      options.threads = threads;
+      return options;
+    }
+
+  public:
+    // numThreads == 0 creates one worker.
+    thread_pool(size_t numThreads) : thread_pool(options_with_threads(numThreads != 0 ? numThreads : 1)) {}
+
+    // Throws std::invalid_argument if options.cpus has a CPU number out of range.
+    explicit thread_pool(thread_pool_options poolOptions)
+        : options(std::move(poolOptions)), taskAllocator(initial_task_nodes, pool_growth{}) {
+      if (options.threads == 0)
+        options.threads = std::max(std::thread::hardware_concurrency(), 1u);
+      for (int cpu : options.cpus) {
+        if (cpu < 0 || cpu >= max_cpus)
+          throw std::invalid_argument("xlib::thread_pool: bad CPU number");
+      }
+
+      for (size_t i = 0; i < options.threads; ++i) {
+        queues.push_back(std::make_unique<worker_t>());
+        queues.back()->rng = 0x9E3779B97F4A7C15ull * (i + 1);
+      }
+      place_workers();
+
+      try {
+        for (size_t i = 0; i < options.threads; ++i)
+          workers.emplace_back([this, i] { run_worker(i); });
+      }
+      catch (...) {
+        join_all();
+        throw;
+      }
+    }
 
-        while (true) {
-          std::function<void()> task;
-          if (!get_task(task)) {
-            break;
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // Runs f(args...) on the pool; the future gets its result or exception.
+    template <class F, class... Args>
+    auto enqueue(F&& f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
+      return enqueue_to(no_node, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    // Like enqueue(), preferably run by a worker of node (an index into nodes()).
+    // Throws std::out_of_range for a bad node.
+    template <class F, class... Args>
+    auto enqueue_on_node(size_t node, F&& f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
+      check_node(node);
+      return enqueue_to(node, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    // Runs f() on the pool without a future. f must not throw: an exception escaping a
+    // posted task terminates the program.
+    template <class F>
+    void post(F&& f) {
+      submit(taskAllocator.allocate_construct(std::forward<F>(f)), no_node);
+    }
+
+    // Like post(), preferably run by a worker of node. Throws std::out_of_range for a bad node.
+    template <class F>
+    void post_on_node(size_t node, F&& f) {
+      check_node(node);
+      submit(taskAllocator.allocate_construct(std::forward<F>(f)), node);
+    }
+
+    // Runs one queued task on the calling thread, if there is one. A thread which waits for
+    // tasks of this pool (see parallel_algorithms.hpp) calls it in a loop, so it helps instead
+    // of blocking a worker. Returns false if no task was found.
+    bool run_pending_task() {
+      task_t* task = nullptr;
+      if (current_worker.pool == this) {
+        task = find_task(current_worker.index);
+      }
+      else {
+        static thread_local std::uint64_t rng = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<std::uintptr_t>(&rng);
+        task = sharedQueue.pop();
+        for (size_t node = 0; task == nullptr && node < nodeQueues.size(); ++node)
+          task = nodeQueues[node]->pop();
+        if (task == nullptr)
+          task = steal(allWorkers, no_worker, rng);
+      }
+
+      if (task == nullptr)
+        return false;
+
+      (*task)();
+      taskAllocator.destroy_deallocate(task);
+      return true;
+    }
+
+    size_t size() const noexcept {
+      return workers.size();
+    }
+
+    const thread_pool_options& settings() const noexcept {
+      return options;
+    }
+
+    // Groups of workers: the NUMA nodes used by the pool, or with worker_placement::none a
+    // single group 0 holding every CPU the process may run on.
+    const std::vector<numa_node>& nodes() const noexcept {
+      return topology;
+    }
+
+    // Index into nodes() of the group of a worker.
+    size_t worker_node(size_t worker) const {
+      return queues.at(worker)->node;
+    }
+
+    // CPUs a worker is pinned to; empty if it isn't.
+    const std::vector<int>& worker_cpus(size_t worker) const {
+      return queues.at(worker)->cpus;
+    }
+
+    ~thread_pool() {
+      join_all();
+    }
+
+  private:
+    static constexpr size_t initial_task_nodes = 256;
+    static constexpr size_t no_worker = static_cast<size_t>(-1);
+    static constexpr size_t no_node = static_cast<size_t>(-1);
+#ifdef __linux__
+    static constexpr int max_cpus = CPU_SETSIZE;
+#else
+    static constexpr int max_cpus = 1 << 16;
+#endif
+
+    thread_pool_options options;
+    task_allocator_t taskAllocator;
+    std::vector<std::unique_ptr<worker_t>> queues;
+    std::vector<std::thread> workers;
+
+    std::vector<numa_node> topology;
+    std::vector<std::vector<size_t>> nodeWorkers;
+    std::vector<size_t> allWorkers;
+
+    injection_queue sharedQueue;                             // tasks without a node
+    std::vector<std::unique_ptr<injection_queue>> nodeQueues; // tasks for one node
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<size_t> sleeping = 0;
+    std::uint64_t wakeEpoch = 0; // guarded by sleepMutex
+    bool stop = false;           // guarded by sleepMutex
+
+    void check_node(size_t node) const {
+      if (node >= topology.size())
+        throw std::out_of_range("xlib::thread_pool: bad node");
+    }
+
+    // Assigns every worker its group and the CPUs to pin it to.
+    void place_workers() {
+      size_t count = queues.size();
+
+      if (!options.cpus.empty()) {
+        topology = numa_topology();
+        for (size_t i = 0; i < count; ++i) {
+          int cpu = options.cpus[i % options.cpus.size()];
+          queues[i]->cpus = {cpu};
+          for (size_t node = 0; node < topology.size(); ++node) {
+            if (std::find(topology[node].cpus.begin(), topology[node].cpus.end(), cpu) != topology[node].cpus.end())
+              queues[i]->node = node;
           }
-          task();
         }
-      };
+      }
+      else if (options.placement == worker_placement::none) {
+        // one node with every allowed CPU; no need to read the NUMA layout from sysfs
+        topology = {numa_node{0, allowed_cpus()}};
+      }
+      else {
+        topology = numa_topology();
+        std::vector<size_t> placed(topology.size(), 0);
+        for (size_t i = 0; i < count; ++i) {
+          size_t node = i * topology.size() / count;
+          const std::vector<int>& cpus = topology[node].cpus;
+          queues[i]->node = node;
+          if (options.placement == worker_placement::cores)
+            queues[i]->cpus = {cpus[placed[node]++ % cpus.size()]};
+          else
+            queues[i]->cpus = cpus;
+        }
+      }
 
-      for (size_t i = 0; i < numThreads; ++i) {
-        workers.emplace_back(loop_of_work);
+      nodeWorkers.resize(topology.size());
+      for (size_t i = 0; i < count; ++i) {
+        nodeWorkers[queues[i]->node].push_back(i);
+        allWorkers.push_back(i);
       }
+      for (size_t node = 0; node < topology.size(); ++node)
+        nodeQueues.push_back(std::make_unique<injection_queue>());
     }
 
     template <class F, class... Args>
-    auto enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type> {
-      using returnType = typename std::result_of<F(Args...)>::type;
+    auto enqueue_to(size_t node, F&& f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
+      using returnType = std::invoke_result_t<F, Args...>;
 
-      auto task = std::make_shared<std::packaged_task<returnType()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+      std::packaged_task<returnType()> task(
+        [f = std::forward<F>(f), ... args = std::forward<Args>(args)]() mutable -> returnType {
+          return std::invoke(f, args...);
+        }
       );
 
-      std::future<returnType> res = task->get_future();
+      std::future<returnType> res = task.get_future();
 
-      {
-        std::unique_lock<std::mutex> lock(queueMutex);
+      submit(taskAllocator.allocate_construct(std::move(task)), node);
 
-        tasks.emplace([task]() { (*task)(); });
-      }
-
-      condition.notify_one();
       return res;
     }
 
-    ~thread_pool() {
+    void join_all() {
       {
-        std::unique_lock<std::mutex> lock(queueMutex);
+        std::unique_lock<std::mutex> lock(sleepMutex);
         stop = true;
       }
 
-      condition.notify_all();
+      wakeCondition.notify_all();
 
       for (std::thread& worker : workers)
         worker.join();
     }
 
-  private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
+    // Names and pins the calling worker; both are best effort.
+    void setup_thread([[maybe_unused]] size_t index) {
+#ifdef __linux__
+      std::string suffix = "-" + std::to_string(index);
+      std::string name = options.name.substr(0, 15 - std::min<size_t>(suffix.size(), 15)) + suffix;
+      pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+
+      if (!queues[index]->cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : queues[index]->cpus)
+          CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      }
+#endif
+    }
+
+    // node is no_node or the group the task should preferably run in.
+    void submit(task_t* task, size_t node) {
+      if (current_worker.pool == this && (node == no_node || queues[current_worker.index]->node == node))
+        queues[current_worker.index]->tasks.push(task);
+      else if (node == no_node)
+        sharedQueue.push(task);
+      else
+        nodeQueues[node]->push(task);
+
+      // pairs with the fence in sleep(): either the worker going to sleep sees the task,
+      // or we see it sleeping and wake it
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (sleeping.load(std::memory_order_relaxed) != 0) {
+        {
+          std::lock_guard<std::mutex> lock(sleepMutex);
+          ++wakeEpoch;
+        }
+        wakeCondition.notify_one();
+      }
+    }
+
+    // Steals from one of victims, starting at a random one. thief is the index of the
+    // stealing worker, or no_worker for other threads.
+    task_t* steal(const std::vector<size_t>& victims, size_t thief, std::uint64_t& rng) {
+      size_t count = victims.size();
+      if (count == 0)
+        return nullptr;
+
+      // xorshift64
+      rng ^= rng << 13;
+      rng ^= rng >> 7;
+      rng ^= rng << 17;
+
+      size_t start = static_cast<size_t>(rng % count);
+      for (size_t i = 0; i < count; ++i) {
+        size_t victim = victims[(start + i) % count];
+        if (victim == thief)
+          continue;
+        if (auto task = queues[victim]->tasks.steal())
+          return *task;
+      }
+      return nullptr;
+    }
+
+    // Own deque, then own node, then anything else.
+    task_t* find_task(size_t index) {
+      worker_t& self = *queues[index];
+      if (auto task = self.tasks.pop())
+        return *task;
+      if (task_t* task = nodeQueues[self.node]->pop())
+        return task;
+      if (task_t* task = sharedQueue.pop())
+        return task;
+      if (topology.size() == 1)
+        return steal(allWorkers, index, self.rng);
+
+      if (task_t* task = steal(nodeWorkers[self.node], index, self.rng))
+        return task;
+      for (size_t node = 0; node < nodeQueues.size(); ++node) {
+        if (task_t* task = nodeQueues[node]->pop())
+          return task;
+      }
+      return steal(allWorkers, index, self.rng);
+    }
+
+    bool has_work() const noexcept {
+      if (!sharedQueue.empty())
+        return true;
+      for (const auto& queue : nodeQueues) {
+        if (!queue->empty())
+          return true;
+      }
+      for (const auto& queue : queues) {
+        if (!queue->tasks.empty())
+          return true;
+      }
+      return false;
+    }
 
-    std::mutex queueMutex;
-    std::condition_variable condition;
-    std::atomic<bool> stop;
+    // Returns false when the pool is stopping and there is no work left.
+    bool sleep() {
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      sleeping.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      bool keep_running = true;
+      if (!has_work()) {
+        if (stop) {
+          keep_running = false;
+        }
+        else {
+          std::uint64_t epoch = wakeEpoch;
+          wakeCondition.wait(lock, [this, epoch] { return wakeEpoch != epoch || stop; });
+        }
+      }
+
+      sleeping.fetch_sub(1, std::memory_order_relaxed);
+      return keep_running;
+    }
+
+    void run_worker(size_t index) {
+      setup_thread(index);
+      current_worker = {this, index};
+
+      while (true) {
+        if (task_t* task = find_task(index)) {
+          (*task)();
+          taskAllocator.destroy_deallocate(task);
+          continue;
+        }
+        if (!sleep())
+          break;
+      }
+
+      current_worker = {nullptr, 0};
+    }
   };
 
-  thread_pool global_thread_pool(std::thread::hardware_concurrency());
-}
+  namespace detail {
+    struct default_thread_pool_state {
+      std::mutex mutex;
+      thread_pool_options options;
+      std::unique_ptr<thread_pool> pool;
+      std::atomic<thread_pool*> created = nullptr;
+    };
+
+    inline default_thread_pool_state& default_thread_pool_state_instance() {
+      static default_thread_pool_state state;
+      return state;
+    }
+  }
+
+  // Sets the options of default_thread_pool(). Throws std::logic_error if the pool already
+  // exists.
+  inline void configure_default_thread_pool(thread_pool_options options) {
+    auto& state = detail::default_thread_pool_state_instance();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.pool != nullptr)
+      throw std::logic_error("xlib::configure_default_thread_pool: the default pool is already running");
+    state.options = std::move(options);
+  }
 
+  // Pool shared by the whole program. It is created with the configured options (by default
+  // one worker per hardware thread) on first use, so programs which never use it don't start
+  // any threads, and destroyed at exit after running its queued tasks.
+  inline thread_pool& default_thread_pool() {
+    auto& state = detail::default_thread_pool_state_instance();
+    if (thread_pool* pool = state.created.load(std::memory_order_acquire))
+      return *pool;
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.pool == nullptr) {
+      state.pool = std::make_unique<thread_pool>(state.options);
+      state.created.store(state.pool.get(), std::memory_order_release);
+    }
+    return *state.pool;
+  }
+}
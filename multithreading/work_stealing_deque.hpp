@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef> // std::ptrdiff_t, std::size_t
+#include <memory> // std::unique_ptr
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "../utility/cache_line.hpp"
+
+namespace xlib {
+  // Chase-Lev work-stealing deque (with the C11 memory orders of Le et al., "Correct and
+  // Efficient Work-Stealing for Weak Memory Models"). The owner thread pushes and pops at
+  // the bottom without any read-modify-write except when taking the last element; other
+  // threads steal from the top with one CAS. The buffer grows when full; old buffers are
+  // kept until the deque is destroyed because a thief may still be reading them.
+  // T must be trivially copyable (typically a pointer to a task).
+  template <typename T>
+  class work_stealing_deque {
+    static_assert(std::is_trivially_copyable_v<T>, "xlib::work_stealing_deque: T must be trivially copyable");
+
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+  private:
+    struct buffer {
+      std::ptrdiff_t mask;
+      std::unique_ptr<std::atomic<T>[]> cells;
+
+      explicit buffer(std::ptrdiff_t capacity)
+          : mask(capacity - 1), cells(new std::atomic<T>[static_cast<size_type>(capacity)]) {}
+
+      std::ptrdiff_t capacity() const noexcept { return mask + 1; }
+
+      T get(std::ptrdiff_t i) const noexcept { return cells[i & mask].load(std::memory_order_relaxed); }
+      void put(std::ptrdiff_t i, T value) noexcept { cells[i & mask].store(value, std::memory_order_relaxed); }
+    };
+
+    alignas(cache_line_size) std::atomic<std::ptrdiff_t> _top = 0;
+    alignas(cache_line_size) std::atomic<std::ptrdiff_t> _bottom = 0;
+    std::atomic<buffer*> _buffer;
+    std::vector<std::unique_ptr<buffer>> _buffers; // owner only: the current and all retired buffers
+
+    buffer* _grow(buffer* old, std::ptrdiff_t top, std::ptrdiff_t bottom) {
+      auto& grown = _buffers.emplace_back(std::make_unique<buffer>(old->capacity() * 2));
+      for (std::ptrdiff_t i = top; i < bottom; ++i)
+        grown->put(i, old->get(i));
+      _buffer.store(grown.get(), std::memory_order_release);
+      return grown.get();
+    }
+
+  public:
+    // capacity is rounded up to a power of two.
+    explicit work_stealing_deque(size_type capacity = 256) {
+      std::ptrdiff_t rounded = 2;
+      while (static_cast<size_type>(rounded) < capacity)
+        rounded *= 2;
+      _buffers.push_back(std::make_unique<buffer>(rounded));
+      _buffer.store(_buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    // Owner only.
+    void push(T value) {
+      std::ptrdiff_t bottom = _bottom.load(std::memory_order_relaxed);
+      std::ptrdiff_t top = _top.load(std::memory_order_acquire);
+      buffer* b = _buffer.load(std::memory_order_relaxed);
+
+      if (bottom - top > b->capacity() - 1)
+        b = _grow(b, top, bottom);
+
+      b->put(bottom, value);
+      _bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    // Owner only; takes the most recently pushed element.
+    std::optional<T> pop() noexcept {
+      std::ptrdiff_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+      buffer* b = _buffer.load(std::memory_order_relaxed);
+      _bottom.store(bottom, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      std::ptrdiff_t top = _top.load(std::memory_order_relaxed);
+
+      std::optional<T> result;
+      if (top <= bottom) {
+        result = b->get(bottom);
+        if (top == bottom) {
+          // the last element: race the thieves for it
+          if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            result.reset();
+          _bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+      }
+      else {
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+      }
+      return result;
+    }
+
+    // Any thread; takes the oldest element. Returns nothing if the deque is empty or another
+    // thread won the race for the element.
+    std::optional<T> steal() noexcept {
+      std::ptrdiff_t top = _top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      std::ptrdiff_t bottom = _bottom.load(std::memory_order_acquire);
+
+      if (top >= bottom)
+        return std::nullopt;
+
+      T value = _buffer.load(std::memory_order_acquire)->get(top);
+      if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return std::nullopt;
+      return value;
+    }
+
+    // Any thread; only a hint while other threads push or pop.
+    bool empty() const noexcept {
+      return _top.load(std::memory_order_relaxed) >= _bottom.load(std::memory_order_relaxed);
+    }
+
+    size_type size() const noexcept {
+      std::ptrdiff_t size = _bottom.load(std::memory_order_relaxed) - _top.load(std::memory_order_relaxed);
+      return size > 0 ? static_cast<size_type>(size) : 0;
+    }
+  };
+}
@@ -0,0 +1,352 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <list>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <allocators/memory_resource/memory_resource.hpp>
+#include <allocators/pool_allocator.hpp>
+
+namespace {
+  // Forwards to the heap and counts what is in flight.
+  class counting_memory_resource : public std::pmr::memory_resource {
+  public:
+    std::size_t allocations = 0;
+    std::size_t in_flight = 0;
+
+  private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+      ++allocations;
+      ++in_flight;
+      return ::operator new(bytes, std::align_val_t(alignment));
+    }
+
+    void do_deallocate(void* ptr, std::size_t, std::size_t alignment) override {
+      --in_flight;
+      ::operator delete(ptr, std::align_val_t(alignment));
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+  };
+}
+
+TEST(monotonic_memory_resource, chains_blocks_and_resets) {
+  counting_memory_resource upstream;
+  {
+    xlib::inline_monotonic_memory_resource<256> arena(&upstream);
+
+    void* small = arena.allocate(64, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(small) % 64, 0u);
+    EXPECT_EQ(upstream.allocations, 0u);
+
+    for (int round = 0; round < 3; ++round) {
+      std::pmr::vector<int> values(&arena);
+      for (int i = 0; i < 10000; ++i)
+        values.push_back(i);
+      EXPECT_EQ(values[9999], 9999);
+      arena.reset();
+    }
+    // the biggest block is kept, so later rounds don't go upstream
+    std::size_t after_first_rounds = upstream.allocations;
+    EXPECT_EQ(upstream.in_flight, 1u);
+
+    {
+      std::pmr::vector<int> values(&arena);
+      values.reserve(10000);
+      EXPECT_EQ(upstream.allocations, after_first_rounds);
+    }
+
+    arena.release();
+    EXPECT_EQ(upstream.in_flight, 0u);
+    EXPECT_NE(arena.allocate(8), nullptr);
+  }
+  EXPECT_EQ(upstream.in_flight, 0u);
+}
+
+TEST(size_class_memory_resource, size_classes) {
+  using resource_t = xlib::size_class_memory_resource<>;
+  for (std::size_t bytes = 1; bytes <= resource_t::max_block_size; ++bytes) {
+    std::size_t index = resource_t::class_index(bytes);
+    ASSERT_GE(resource_t::class_size(index), bytes);
+    ASSERT_TRUE(index == 0 || resource_t::class_size(index - 1) < bytes);
+  }
+}
+
+TEST(size_class_memory_resource, reuses_blocks) {
+  counting_memory_resource upstream;
+  {
+    xlib::size_class_memory_resource<> pool(&upstream);
+
+    void* a = pool.allocate(24);
+    pool.deallocate(a, 24);
+    EXPECT_EQ(pool.allocate(20), a);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a) % alignof(std::max_align_t), 0u);
+    pool.deallocate(a, 20);
+
+    std::size_t slabs = upstream.allocations;
+    for (int round = 0; round < 10; ++round) {
+      std::pmr::list<std::pmr::string> strings(&pool);
+      for (int i = 0; i < 1000; ++i)
+        strings.emplace_back(std::string(i % 100, 'x'));
+    }
+    std::size_t after_first_round = upstream.allocations;
+    EXPECT_GT(after_first_round, slabs);
+    {
+      std::pmr::list<std::pmr::string> strings(&pool);
+      for (int i = 0; i < 1000; ++i)
+        strings.emplace_back(std::string(i % 100, 'x'));
+    }
+    EXPECT_EQ(upstream.allocations, after_first_round);
+
+    void* big = pool.allocate(10000);
+    EXPECT_EQ(upstream.allocations, after_first_round + 1);
+    pool.deallocate(big, 10000);
+  }
+  EXPECT_EQ(upstream.in_flight, 0u);
+}
+
+TEST(size_class_memory_resource, thread_safe) {
+  xlib::size_class_memory_resource<xlib::thread_safety<true>> pool;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&pool, t] {
+      for (int round = 0; round < 100; ++round) {
+        std::pmr::vector<std::pmr::vector<int>> vectors(&pool);
+        for (int i = 0; i < 100; ++i)
+          vectors.emplace_back(static_cast<std::size_t>(i % 50 + 1), t);
+        for (auto& vector : vectors)
+          ASSERT_EQ(vector.back(), t);
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+}
+
+TEST(huge_page_memory_resource, maps_and_falls_back) {
+  for (auto mode : {xlib::huge_page_mode::none, xlib::huge_page_mode::transparent, xlib::huge_page_mode::hugetlb}) {
+    // node 0 always exists; the binding is best effort anyway
+    xlib::huge_page_memory_resource pages({.mode = mode, .numa_node = 0});
+
+    constexpr std::size_t big = 3 * 1024 * 1024;
+    auto* ptr = static_cast<char*>(pages.allocate(big));
+    if (mode != xlib::huge_page_mode::none) {
+      EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % pages.options().huge_page_size, 0u);
+    }
+    ptr[0] = ptr[big - 1] = 1;
+    pages.deallocate(ptr, big);
+
+    void* small = pages.allocate(100, 8192);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(small) % 8192, 0u);
+    pages.deallocate(small, 100, 8192);
+
+    xlib::monotonic_memory_resource arena(1024 * 1024, &pages);
+    std::pmr::vector<int> values(&arena);
+    values.assign(1000000, 7);
+    EXPECT_EQ(values.back(), 7);
+  }
+}
+
+TEST(tracking_memory_resource, counts_and_samples) {
+  xlib::heap_memory_resource heap;
+  xlib::tracking_memory_resource tracking(&heap, {.sample_every = 1});
+  {
+    std::pmr::vector<int> values(&tracking);
+    values.reserve(100);
+    void* small = tracking.allocate(3);
+
+    auto stats = tracking.stats();
+    EXPECT_EQ(stats.allocations_in_flight, 2u);
+    EXPECT_EQ(stats.bytes_in_flight, 403u);
+    EXPECT_EQ(tracking.histogram()[2], 1u);   // (2, 4]
+    EXPECT_EQ(tracking.histogram()[9], 1u);   // (256, 512]
+
+    tracking.deallocate(small, 3);
+    values.reserve(1000);
+  }
+
+  auto stats = tracking.stats();
+  EXPECT_EQ(stats.bytes_in_flight, 0u);
+  EXPECT_EQ(stats.allocations_in_flight, 0u);
+  EXPECT_EQ(stats.peak_bytes, 4400u);
+  EXPECT_EQ(stats.total_allocations, 3u);
+
+  std::size_t samples = 0;
+  for (const auto& site : tracking.call_sites()) {
+    samples += site.samples;
+    EXPECT_EQ(site.bytes_in_flight, 0u);
+  }
+#if __has_include(<execinfo.h>)
+  EXPECT_EQ(samples, 3u);
+#endif
+}
+
+TEST(frame_memory_resource, nested_frames_rewind) {
+  auto& arena = xlib::frame_memory_resource::local();
+  void* first = nullptr;
+  {
+    xlib::frame_memory_resource::frame outer;
+    first = outer.resource()->allocate(16);
+    {
+      xlib::frame_memory_resource::frame inner;
+      std::pmr::vector<int> values(inner.resource());
+      for (int i = 0; i < 100000; ++i)
+        values.push_back(i);
+      EXPECT_EQ(values.back(), 99999);
+    }
+    // the inner frame is gone, so its memory is the next to be handed out
+    void* next = outer.resource()->allocate(16);
+    EXPECT_EQ(static_cast<char*>(next), static_cast<char*>(first) + 16);
+  }
+
+  std::size_t reserved = arena.reserved();
+  {
+    xlib::frame_memory_resource::frame frame;
+    EXPECT_EQ(frame.resource()->allocate(16), first);
+    std::pmr::vector<int> values(frame.resource());
+    values.assign(100000, 1);
+  }
+  EXPECT_EQ(arena.reserved(), reserved);
+
+  void* other_thread = nullptr;
+  std::thread([&] {
+    xlib::frame_memory_resource::frame frame;
+    other_thread = frame.resource()->allocate(16);
+  }).join();
+  EXPECT_NE(other_thread, first);
+}
+
+TEST(stack_memory_resource, reclaims_the_top) {
+  counting_memory_resource upstream;
+  xlib::stack_memory_resource<1024> stack(&upstream);
+
+  // exactly filling the buffer fits; one more byte goes upstream
+  void* all = stack.allocate(1024, 1);
+  void* spilled = stack.allocate(1, 1);
+  EXPECT_EQ(upstream.allocations, 1u);
+  stack.deallocate(spilled, 1, 1);
+  stack.deallocate(all, 1024, 1);
+  EXPECT_EQ(stack.used(), 0u);
+  EXPECT_EQ(upstream.in_flight, 0u);
+
+  // blocks separated by alignment padding are reclaimed in either order
+  void* byte = stack.allocate(1, 1);
+  void* word = stack.allocate(8, 8);
+  stack.deallocate(byte, 1, 1);
+  stack.deallocate(word, 8, 8);
+  EXPECT_EQ(stack.used(), 0u);
+
+  byte = stack.allocate(1, 1);
+  word = stack.allocate(8, 8);
+  stack.deallocate(word, 8, 8);
+  stack.deallocate(byte, 1, 1);
+  EXPECT_EQ(stack.used(), 0u);
+
+  // the top never moves below a live block, even when the freed one below it was padded
+  auto* first = static_cast<char*>(stack.allocate(1, 1));
+  auto* live = static_cast<char*>(stack.allocate(1, 1));
+  void* padded = stack.allocate(8, 8);
+  *live = 42;
+  stack.deallocate(padded, 8, 8);
+  stack.deallocate(first, 1, 1);
+  EXPECT_NE(stack.used(), 0u);
+  auto* next = static_cast<char*>(stack.allocate(4, 1));
+  EXPECT_GE(next, live + 1);
+  EXPECT_EQ(*live, 42);
+  stack.deallocate(next, 4, 1);
+  stack.deallocate(live, 1, 1);
+  EXPECT_EQ(stack.used(), 0u);
+
+  for (int round = 0; round < 100; ++round) {
+    std::pmr::vector<int> values(&stack);
+    for (int i = 0; i < 100; ++i)
+      values.push_back(i);
+    EXPECT_EQ(values.back(), 99);
+  }
+  // the vector's old buffers were freed below the top, but are reclaimed with it
+  EXPECT_EQ(stack.used(), 0u);
+  EXPECT_EQ(upstream.allocations, 1u);
+
+  xlib::stack_memory_resource<64> strict;
+  EXPECT_THROW((void)strict.allocate(65), std::bad_alloc);
+}
+
+TEST(slab_cache, partial_slabs_first_and_coloring) {
+  counting_memory_resource upstream;
+  {
+    xlib::slab_cache cache(48, 16, &upstream);
+    std::size_t per_slab = cache.objects_per_slab();
+
+    std::vector<void*> objects;
+    for (std::size_t i = 0; i < 3 * per_slab; ++i)
+      objects.push_back(cache.allocate());
+    EXPECT_EQ(cache.slab_count(), 3u);
+    EXPECT_EQ(std::set<void*>(objects.begin(), objects.end()).size(), objects.size());
+
+    // slabs start their objects at different offsets
+    auto offset = [&](void* ptr) { return reinterpret_cast<std::uintptr_t>(ptr) % cache.slab_size(); };
+    EXPECT_NE(offset(objects[0]), offset(objects[per_slab]));
+
+    // a hole in the first slab is filled before anything else
+    cache.deallocate(objects[5]);
+    EXPECT_EQ(cache.allocate(), objects[5]);
+
+    // one empty slab is kept, the others go back upstream
+    for (void* ptr : objects)
+      cache.deallocate(ptr);
+    EXPECT_EQ(cache.slab_count(), 1u);
+    EXPECT_EQ(upstream.in_flight, 1u);
+  }
+  EXPECT_EQ(upstream.in_flight, 0u);
+}
+
+TEST(slab_cache, constructor_caching) {
+  static int constructed = 0;
+  struct connection {
+    std::vector<char> buffer = std::vector<char>(256);
+    connection() { ++constructed; }
+  };
+
+  xlib::object_cache<connection> cache;
+  connection* c = cache.allocate();
+  int after_first_slab = constructed;
+  EXPECT_EQ(static_cast<std::size_t>(after_first_slab), cache.cache().objects_per_slab());
+
+  c->buffer[0] = 'x';
+  cache.deallocate(c);
+  connection* again = cache.allocate();
+  EXPECT_EQ(again, c);
+  EXPECT_EQ(again->buffer.size(), 256u);
+  EXPECT_EQ(constructed, after_first_slab);
+  cache.deallocate(again);
+}
+
+TEST(slab_memory_resource, backs_containers_and_pools) {
+  xlib::slab_memory_resource slabs;
+  {
+    std::pmr::list<std::pmr::string> strings(&slabs);
+    for (int i = 0; i < 1000; ++i)
+      strings.emplace_back(std::string(i % 64, 'x'));
+    EXPECT_EQ(strings.back().size(), 999u % 64);
+  }
+
+  void* block = slabs.allocate(24);
+  xlib::slab_memory_resource::free(block);
+  EXPECT_EQ(slabs.allocate(24), block);
+  slabs.deallocate(block, 24);
+
+  // the pool takes its chunks from the slabs
+  xlib::pool_allocator<long> pool(16, xlib::pool_growth{.max_count = 64}, 0, &slabs);
+  std::vector<long*> values;
+  for (long i = 0; i < 64; ++i)
+    values.push_back(pool.allocate_construct(i));
+  for (long i = 0; i < 64; ++i) {
+    EXPECT_EQ(*values[i], i);
+    pool.destroy_deallocate(values[i]);
+  }
+}
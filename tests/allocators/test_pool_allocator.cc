@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <iostream>
+#include <latch>
+#include <list>
+#include <memory_resource>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <allocators/pool_allocator.hpp>
+#include <containers/avl_tree.hpp>
+
+TEST(pool_allocator, reuses_freed_slots) {
+  xlib::pool_allocator<std::string> pool(3);
+
+  auto* a = pool.allocate_construct("a");
+  auto* b = pool.allocate_construct("b");
+  auto* c = pool.allocate_construct("c");
+  EXPECT_EQ(pool.allocate(), nullptr);
+  EXPECT_THROW(pool.allocate_construct("x"), std::bad_alloc);
+  EXPECT_EQ(std::set<std::string*>({a, b, c}).size(), 3u);
+
+  pool.destroy_deallocate(b);
+  auto* d = pool.allocate_construct("d");
+  EXPECT_EQ(d, b);
+  EXPECT_EQ(*d, "d");
+
+  pool.destroy_deallocate(a);
+  pool.destroy_deallocate(c);
+  pool.destroy_deallocate(d);
+}
+
+TEST(pool_allocator, thread_safe_pool) {
+  constexpr int threads_count = 4, per_thread = 64, rounds = 2000;
+  using pool_t = xlib::pool_allocator<long, xlib::thread_safety<true>>;
+  // every thread may keep up to thread_cache_size free slots in its own cache
+  pool_t pool(threads_count * (per_thread + pool_t::default_thread_cache_size));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&pool, t] {
+      std::vector<long*> owned;
+      for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < per_thread; ++i) {
+          long* ptr = pool.allocate_construct(t);
+          ASSERT_NE(ptr, nullptr);
+          owned.push_back(ptr);
+        }
+        for (long* ptr : owned) {
+          ASSERT_EQ(*ptr, t);
+          pool.destroy_deallocate(ptr);
+        }
+        owned.clear();
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+}
+
+TEST(pool_allocator, cross_thread_frees) {
+  xlib::pool_allocator<int, xlib::thread_safety<true>> pool(256, 8);
+
+  std::vector<int*> allocated;
+  for (int i = 0; i < 100; ++i)
+    allocated.push_back(pool.allocate_construct(i));
+
+  std::thread([&] {
+    for (int* ptr : allocated)
+      pool.destroy_deallocate(ptr);
+  }).join();
+
+  // the freeing thread has exited and flushed its cache back to the pool
+  std::vector<int*> again;
+  for (int i = 0; i < 256 - 8; ++i) {
+    again.push_back(pool.allocate());
+    ASSERT_NE(again.back(), nullptr);
+  }
+}
+
+TEST(pool_allocator, frees_from_a_thread_without_a_cache_are_shared) {
+  xlib::pool_allocator<int, xlib::thread_safety<true>> pool(4, 8);
+
+  std::vector<int*> allocated;
+  for (int i = 0; i < 4; ++i)
+    allocated.push_back(pool.allocate_construct(i));
+
+  // the freeing thread never allocated, so it has no cache and must not create one
+  std::latch freed(1), done(1);
+  std::thread freeing([&] {
+    for (int* ptr : allocated)
+      pool.destroy_deallocate(ptr);
+    freed.count_down();
+    done.wait();
+  });
+  freed.wait();
+
+  for (int i = 0; i < 4; ++i)
+    EXPECT_NE(pool.allocate(), nullptr);
+  done.count_down();
+  freeing.join();
+}
+
+TEST(pool_allocator, used_after_thread_caches_are_destroyed) {
+  using pool_t = xlib::pool_allocator<int, xlib::thread_safety<true>>;
+  pool_t pool(16, 8);
+
+  struct late_user {
+    pool_t* pool = nullptr;
+    int* ptr = nullptr;
+
+    ~late_user() {
+      if (pool == nullptr)
+        return;
+      pool->deallocate(ptr);
+      pool->deallocate(pool->allocate_construct(1));
+    }
+  };
+
+  std::thread([&pool] {
+    // Constructed before the first allocation, so it is destroyed after the thread's caches
+    thread_local late_user user;
+    user.pool = &pool;
+    user.ptr = pool.allocate_construct(0);
+  }).join();
+
+  std::vector<int*> allocated;
+  for (int i = 0; i < 16; ++i) {
+    allocated.push_back(pool.allocate());
+    ASSERT_NE(allocated.back(), nullptr);
+  }
+}
+
+TEST(pool_allocator, grows_by_chunks) {
+  xlib::pool_allocator<std::string> pool(2, xlib::pool_growth{.max_count = 10});
+
+  std::vector<std::string*> allocated;
+  for (int i = 0; i < 10; ++i)
+    allocated.push_back(pool.allocate_construct(std::to_string(i)));
+
+  EXPECT_EQ(pool.capacity(), 10u);
+  EXPECT_EQ(pool.allocate(), nullptr);
+  EXPECT_EQ(std::set<std::string*>(allocated.begin(), allocated.end()).size(), 10u);
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(*allocated[i], std::to_string(i));
+    pool.destroy_deallocate(allocated[i]);
+  }
+}
+
+TEST(pool_allocator, rejects_chunks_beyond_48_bits) {
+  // Pretends to map memory above 2^48, as 5-level paging allows; the pool never touches it.
+  struct high_memory_resource : std::pmr::memory_resource {
+    int deallocations = 0;
+
+    void* do_allocate(std::size_t, std::size_t) override {
+      return reinterpret_cast<void*>(std::uintptr_t(1) << 50);
+    }
+    void do_deallocate(void*, std::size_t, std::size_t) override { ++deallocations; }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+  };
+
+  if constexpr (sizeof(void*) == 8) {
+    high_memory_resource upstream;
+    using pool_t = xlib::pool_allocator<long, xlib::thread_safety<true>>;
+    EXPECT_THROW(pool_t(16, pool_t::default_thread_cache_size, &upstream), std::bad_alloc);
+    EXPECT_EQ(upstream.deallocations, 1);
+  }
+}
+
+TEST(pool_allocator, thread_safe_growth) {
+  constexpr int threads_count = 4, per_thread = 1000;
+  xlib::pool_allocator<int, xlib::thread_safety<true>> pool(1, xlib::pool_growth{});
+  std::latch all_allocated(threads_count);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&pool, &all_allocated, t] {
+      std::vector<int*> owned;
+      for (int i = 0; i < per_thread; ++i)
+        owned.push_back(pool.allocate_construct(t));
+      all_allocated.arrive_and_wait();
+      for (int* ptr : owned) {
+        ASSERT_EQ(*ptr, t);
+        pool.destroy_deallocate(ptr);
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_GE(pool.capacity(), std::size_t(threads_count * per_thread));
+}
+
+TEST(pool_allocator, std_containers) {
+  using allocator_t = xlib::pool_allocator<int>;
+  static_assert(std::is_same_v<std::allocator_traits<allocator_t>::rebind_alloc<long>, xlib::pool_allocator<long>>);
+
+  static_assert(std::is_nothrow_constructible_v<xlib::pool_allocator<double>, const allocator_t&>);
+
+  allocator_t allocator(4, xlib::pool_growth{});
+  xlib::pool_allocator<double> rebound(allocator);
+  EXPECT_TRUE(rebound == allocator);
+
+  // A rebound copy for the same slot layout shares the pool, which it looks up on first use
+  int* slot = allocator.allocate();
+  xlib::pool_allocator<unsigned> same_layout(rebound);
+  same_layout.deallocate(reinterpret_cast<unsigned*>(slot));
+  EXPECT_EQ(allocator.allocate(), slot);
+  allocator.deallocate(slot);
+  EXPECT_FALSE(allocator_t(4) == allocator);
+
+  std::list<int, allocator_t> list(allocator);
+  for (int i = 0; i < 100; ++i)
+    list.push_back(i);
+  list.remove_if([](int i) { return i % 2 == 0; });
+  EXPECT_EQ(list.size(), 50u);
+  EXPECT_EQ(list.front(), 1);
+
+  using map_allocator_t = xlib::pool_allocator<std::pair<const int, std::string>>;
+  std::map<int, std::string, std::less<>, map_allocator_t> map{map_allocator_t(allocator)};
+  for (int i = 0; i < 100; ++i)
+    map.emplace(i, std::to_string(i));
+  EXPECT_EQ(map.at(42), "42");
+
+  // n != 1 falls back to ::operator new
+  std::vector<int, allocator_t> vector(allocator);
+  vector.assign(1000, 7);
+  EXPECT_EQ(vector[999], 7);
+
+  xlib::container::avl_tree<int, std::string, std::less<int>, map_allocator_t> tree(map_allocator_t{allocator});
+  for (int key : {4, 2, 6, 1, 3, 5, 7})
+    tree[key] = std::to_string(key);
+  EXPECT_EQ(tree.size(), 7u);
+  EXPECT_EQ(tree[3], "3");
+}
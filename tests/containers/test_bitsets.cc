@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <containers/dynamic_bitset.hpp>
+#include <containers/roaring_bitmap.hpp>
+
+TEST(dynamic_bitset, set_ops_and_scan) {
+  xlib::container::dynamic_bitset<> a(130), b(130);
+  a.set(0).set(64).set(129);
+  b.set(64).set(100);
+
+  EXPECT_EQ(a.count(), 3u);
+  EXPECT_EQ((a & b).count(), 1u);
+  EXPECT_EQ((a | b).count(), 4u);
+  EXPECT_EQ((a ^ b).count(), 3u);
+  EXPECT_EQ((a - b).count(), 2u);
+  EXPECT_EQ(a.and_count(b), 1u);
+  EXPECT_TRUE(a.intersects(b));
+  EXPECT_FALSE((a & b).is_subset_of(a - b));
+
+  std::vector<std::size_t> positions;
+  for (auto i = a.find_first(); i != a.npos; i = a.find_next(i))
+    positions.push_back(i);
+  EXPECT_EQ(positions, (std::vector<std::size_t>{0, 64, 129}));
+
+  // Bits past size() never leak into count()
+  EXPECT_EQ((~a).count(), 127u);
+  a.resize(200, true);
+  EXPECT_EQ(a.count(), 73u);
+  a.resize(65);
+  EXPECT_EQ(a.count(), 2u);
+}
+
+TEST(roaring_bitmap, set_ops_across_containers) {
+  xlib::container::roaring_bitmap a{1, 2, 3, 70000, 1u << 31};
+  xlib::container::roaring_bitmap b{3, 4, 70000};
+
+  EXPECT_EQ(a.cardinality(), 5u);
+  EXPECT_EQ((a & b).to_vector(), (std::vector<std::uint32_t>{3, 70000}));
+  EXPECT_EQ((a | b).cardinality(), 6u);
+  EXPECT_EQ((a - b).to_vector(), (std::vector<std::uint32_t>{1, 2, 1u << 31}));
+  EXPECT_EQ(a.and_cardinality(b), 2u);
+  EXPECT_TRUE(a.intersects(b));
+  EXPECT_FALSE((a - b).intersects(b));
+
+  std::vector<std::uint32_t> values(a.begin(), a.end());
+  EXPECT_EQ(values, a.to_vector());
+}
+
+TEST(roaring_bitmap, array_bitmap_boundary) {
+  using container_t = xlib::container::detail::roaring_container;
+  constexpr std::uint32_t limit = container_t::max_array_size;
+
+  container_t c(0);
+  for (std::uint32_t i = 0; i <= limit; ++i)
+    c.add(static_cast<std::uint16_t>(i));
+  EXPECT_TRUE(c.is_bitmap());
+  c.remove(0);
+  EXPECT_TRUE(c.is_bitmap());
+  c.add(0);
+  EXPECT_TRUE(c.is_bitmap());
+  for (std::uint32_t i = 0; i < limit - container_t::min_bitmap_size + 1; ++i)
+    c.remove(static_cast<std::uint16_t>(i));
+  EXPECT_FALSE(c.is_bitmap());
+  EXPECT_EQ(c.cardinality(), container_t::min_bitmap_size);
+
+  xlib::container::roaring_bitmap dense, sparse;
+  for (std::uint32_t i = 0; i < limit; ++i)
+    dense.add(i * 2);
+  EXPECT_EQ(dense.cardinality(), limit);
+
+  // One past the array limit becomes a bitmap; dropping back below keeps it until min_bitmap_size
+  dense.add(1);
+  EXPECT_EQ(dense.cardinality(), limit + 1);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(dense.remove(1));
+    EXPECT_TRUE(dense.add(1));
+  }
+  EXPECT_TRUE(dense.contains(1));
+  EXPECT_TRUE(dense.remove(1));
+  EXPECT_EQ(dense.cardinality(), limit);
+
+  for (std::uint32_t i = 0; i < limit; i += 2)
+    sparse.add(i * 2);
+  EXPECT_EQ(sparse.cardinality(), limit / 2);
+
+  // Same values in different representations still compare equal
+  xlib::container::roaring_bitmap rebuilt;
+  for (std::uint32_t i = 0; i < limit; ++i)
+    rebuilt.add(i * 2);
+  EXPECT_EQ(dense, rebuilt);
+
+  EXPECT_EQ((dense & sparse).cardinality(), limit / 2);
+  EXPECT_EQ(dense.and_cardinality(sparse), limit / 2);
+  EXPECT_EQ((dense | sparse), dense);
+  EXPECT_EQ((dense - sparse).cardinality(), limit / 2);
+  EXPECT_TRUE(dense.intersects(sparse));
+
+  xlib::container::roaring_bitmap odd;
+  for (std::uint32_t i = 0; i < 2 * limit; ++i)
+    odd.add(i * 2 + 1);
+  EXPECT_FALSE(dense.intersects(odd));
+  EXPECT_EQ((dense | odd).cardinality(), 3 * limit);
+  EXPECT_TRUE((dense & odd).empty());
+
+  for (std::uint32_t i = 0; i < limit; ++i)
+    dense.remove(i * 2);
+  EXPECT_TRUE(dense.empty());
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <containers/d_ary_heap.hpp>
+#include <containers/indexed_priority_queue.hpp>
+
+TEST(d_ary_heap, pops_in_order) {
+  std::mt19937 rng(42);
+  std::vector<int> values(1000);
+  for (int& v : values)
+    v = static_cast<int>(rng() % 500);
+
+  xlib::container::d_ary_heap<int> heap;
+  for (int v : values)
+    heap.push(v);
+  EXPECT_EQ(heap.size(), values.size());
+
+  std::vector<int> popped;
+  while (!heap.empty()) {
+    popped.push_back(heap.top());
+    heap.pop();
+  }
+  std::sort(values.begin(), values.end());
+  EXPECT_EQ(popped, values);
+
+  xlib::container::d_ary_heap<int, 2, std::greater<int>> max_heap;
+  for (int v : {3, 9, 1, 7})
+    max_heap.push(v);
+  EXPECT_EQ(max_heap.top(), 9);
+  max_heap.replace_top(0);
+  EXPECT_EQ(max_heap.top(), 7);
+}
+
+TEST(indexed_priority_queue, decrease_key_and_erase) {
+  xlib::container::indexed_priority_queue<int> queue;
+  for (std::size_t id = 0; id < 10; ++id)
+    queue.push(id, static_cast<int>(100 + id));
+  EXPECT_THROW(queue.push(3, 0), std::invalid_argument);
+
+  queue.decrease_key(7, 5);
+  EXPECT_EQ(queue.top(), 7u);
+  EXPECT_EQ(queue.top_priority(), 5);
+
+  queue.increase_key(7, 200);
+  EXPECT_EQ(queue.top(), 0u);
+
+  queue.update(9, 1);
+  queue.update(42, 2);
+  EXPECT_TRUE(queue.contains(42));
+
+  EXPECT_TRUE(queue.erase(9));
+  EXPECT_FALSE(queue.erase(9));
+  EXPECT_FALSE(queue.contains(9));
+  EXPECT_TRUE(queue.erase(4));
+  EXPECT_THROW(queue.decrease_key(9, 0), std::out_of_range);
+  EXPECT_THROW(queue.increase_key(1000, 0), std::out_of_range);
+
+  std::vector<std::size_t> order;
+  while (!queue.empty())
+    order.push_back(queue.pop());
+  EXPECT_EQ(order, (std::vector<std::size_t>{42, 0, 1, 2, 3, 5, 6, 8, 7}));
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <containers/intrusive_list.hpp>
+#include <containers/intrusive_hash_set.hpp>
+#include <containers/intrusive_avl_tree.hpp>
+
+namespace {
+  struct connection
+      : xlib::container::intrusive_list_hook<>
+      , xlib::container::intrusive_hash_set_hook<>
+      , xlib::container::intrusive_avl_tree_hook<> {
+    int id = 0;
+
+    explicit connection(int id) : id(id) {}
+
+    bool operator<(const connection& other) const { return id < other.id; }
+    bool operator==(const connection& other) const { return id == other.id; }
+  };
+
+  struct connection_hash {
+    std::size_t operator()(const connection& c) const { return std::hash<int>{}(c.id); }
+  };
+}
+
+TEST(intrusive_list, link_unlink) {
+  connection a(1), b(2), c(3);
+  xlib::container::intrusive_list<connection> list;
+
+  list.push_back(a);
+  list.push_back(b);
+  list.push_front(c);
+  EXPECT_EQ(list.size(), 3u);
+  EXPECT_EQ(list.front().id, 3);
+
+  b.xlib::container::intrusive_list_hook<>::unlink();
+  EXPECT_EQ(list.size(), 2u);
+  EXPECT_EQ(list.back().id, 1);
+
+  {
+    connection d(4);
+    list.push_back(d);
+  }
+  EXPECT_EQ(list.size(), 2u);
+
+  // Inserting an element before itself leaves the list intact
+  list.insert(list.iterator_to(a), a);
+  ASSERT_EQ(list.size(), 2u);
+  EXPECT_EQ(list.front().id, 3);
+  EXPECT_EQ(list.back().id, 1);
+}
+
+TEST(intrusive_hash_set, insert_find_erase) {
+  std::vector<connection> storage;
+  for (int i = 0; i < 200; ++i)
+    storage.emplace_back(i);
+
+  xlib::container::intrusive_hash_set<connection, connection_hash> set(4);
+  for (auto& c : storage)
+    EXPECT_TRUE(set.insert(c).second);
+  EXPECT_FALSE(set.insert(storage[5]).second);
+  EXPECT_EQ(set.size(), 200u);
+
+  set.erase(storage[10]);
+  EXPECT_FALSE(set.contains(connection(10)));
+  EXPECT_TRUE(set.contains(connection(11)));
+  EXPECT_EQ(std::distance(set.begin(), set.end()), 199);
+
+  // rehash() never drops below size() / max_load_factor()
+  set.rehash(1);
+  EXPECT_GE(static_cast<float>(set.bucket_count()) * set.max_load_factor(), 199.0f);
+  EXPECT_TRUE(set.contains(connection(150)));
+}
+
+TEST(intrusive_hash_set, hook_unlinks_itself) {
+  xlib::container::intrusive_hash_set<connection, connection_hash> set;
+  connection a(1);
+  set.insert(a);
+  {
+    connection b(2);
+    set.insert(b);
+    EXPECT_EQ(set.size(), 2u);
+  }
+  EXPECT_EQ(set.size(), 1u);
+  EXPECT_FALSE(set.contains(connection(2)));
+
+  // Inserting into another set moves the element out of the first one
+  xlib::container::intrusive_hash_set<connection, connection_hash> other;
+  EXPECT_TRUE(other.insert(a).second);
+  EXPECT_TRUE(set.empty());
+  EXPECT_FALSE(set.contains(connection(1)));
+  EXPECT_TRUE(other.contains(connection(1)));
+
+  a.xlib::container::intrusive_hash_set_hook<>::unlink();
+  EXPECT_TRUE(other.empty());
+  EXPECT_FALSE(a.xlib::container::intrusive_hash_set_hook<>::is_linked());
+  EXPECT_TRUE(set.empty());
+  EXPECT_EQ(set.begin(), set.end());
+}
+
+TEST(intrusive_avl_tree, stays_balanced_and_sorted) {
+  std::vector<connection> storage;
+  for (int i = 0; i < 1000; ++i)
+    storage.emplace_back(i);
+  std::shuffle(storage.begin(), storage.end(), std::mt19937(42));
+
+  xlib::container::intrusive_avl_tree<connection> tree;
+  for (auto& c : storage)
+    tree.insert(c);
+  EXPECT_LE(tree.height(), 15);
+
+  for (auto& c : storage) {
+    if (c.id % 2 == 0)
+      tree.erase(c);
+  }
+  EXPECT_EQ(tree.size(), 500u);
+  EXPECT_LE(tree.height(), 14);
+
+  int expected = 1;
+  for (auto& c : tree) {
+    EXPECT_EQ(c.id, expected);
+    expected += 2;
+  }
+  EXPECT_EQ((*--tree.end()).id, 999);
+  EXPECT_EQ(tree.lower_bound(connection(500))->id, 501);
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+#include <containers/slot_map.hpp>
+
+TEST(slot_map, stale_handles_are_detected) {
+  xlib::container::slot_map<std::string> map;
+  auto a = map.insert("a");
+  auto b = map.insert("b");
+  auto c = map.insert("c");
+  EXPECT_EQ(map.size(), 3u);
+
+  EXPECT_TRUE(map.erase(a));
+  EXPECT_FALSE(map.erase(a));
+  EXPECT_FALSE(map.contains(a));
+  EXPECT_EQ(map.find(a), nullptr);
+  EXPECT_THROW(map.at(a), std::out_of_range);
+
+  // The last element moved into the hole, its handle still works
+  EXPECT_EQ(map[c], "c");
+  EXPECT_EQ(map.at(b), "b");
+  EXPECT_FALSE(map.contains(xlib::container::slot_map_handle{}));
+}
+
+TEST(slot_map, slots_are_reused_with_a_new_generation) {
+  xlib::container::slot_map<int> map;
+  auto a = map.insert(1);
+  map.insert(2);
+  map.erase(a);
+
+  auto reused = map.insert(3);
+  EXPECT_EQ(reused.index, a.index);
+  EXPECT_NE(reused.generation, a.generation);
+  EXPECT_FALSE(map.contains(a));
+  EXPECT_EQ(map[reused], 3);
+  EXPECT_EQ(map.size(), 2u);
+
+  std::unordered_set<xlib::container::slot_map_handle> handles;
+  for (std::size_t i = 0; i < map.size(); ++i)
+    handles.insert(map.handle_of(i));
+  EXPECT_TRUE(handles.contains(reused));
+
+  // Erasing while iterating visits every element once
+  int sum = 0;
+  for (auto it = map.begin(); it != map.end();) {
+    sum += *it;
+    it = map.erase(it);
+  }
+  EXPECT_EQ(sum, 5);
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.contains(reused));
+}
+
+TEST(slot_map, throwing_constructor_leaves_no_slot_behind) {
+  struct throws_on_negative {
+    explicit throws_on_negative(int v) {
+      if (v < 0)
+        throw std::invalid_argument("negative");
+    }
+  };
+
+  xlib::container::slot_map<throws_on_negative> map;
+  EXPECT_THROW(map.emplace(-1), std::invalid_argument);
+  EXPECT_TRUE(map.empty());
+
+  auto a = map.emplace(1);
+  EXPECT_EQ(a.index, 0u);
+  EXPECT_TRUE(map.contains(a));
+}
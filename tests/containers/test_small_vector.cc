@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include <containers/inplace_vector.hpp>
+#include <containers/small_vector.hpp>
+#include <algorithms/graph.hpp>
+
+TEST(inplace_vector, basic) {
+  xlib::container::inplace_vector<std::string, 4> v = {"a", "b"};
+  v.push_back("c");
+  v.insert(v.begin(), "z");
+
+  ASSERT_EQ(v.size(), 4u);
+  EXPECT_EQ(v.front(), "z");
+  EXPECT_EQ(v.back(), "c");
+  EXPECT_EQ(v.try_push_back("d"), nullptr);
+  EXPECT_THROW(v.push_back("d"), std::bad_alloc);
+
+  v.erase(v.begin() + 1);
+  EXPECT_EQ(v, (xlib::container::inplace_vector<std::string, 4>{"z", "b", "c"}));
+}
+
+TEST(small_vector, spills_to_heap) {
+  xlib::container::small_vector<std::string, 2> v;
+  v.push_back("a");
+  v.push_back("b");
+  EXPECT_TRUE(v.is_inline());
+
+  v.push_back(v.front());
+  EXPECT_FALSE(v.is_inline());
+  ASSERT_EQ(v.size(), 3u);
+  EXPECT_EQ(v[2], "a");
+
+  auto moved = std::move(v);
+  EXPECT_TRUE(v.empty());
+  EXPECT_EQ(moved.size(), 3u);
+
+  moved.resize(1);
+  moved.shrink_to_fit();
+  EXPECT_TRUE(moved.is_inline());
+  EXPECT_EQ(moved[0], "a");
+}
+
+namespace {
+  struct throwing_copy {
+    static inline int copies_left = 0;
+    int value;
+
+    throwing_copy(int value) : value(value) {}
+    throwing_copy(const throwing_copy& other) : value(other.value) {
+      if (copies_left-- == 0)
+        throw std::runtime_error("copy");
+    }
+    throwing_copy(throwing_copy&& other) noexcept(false) : value(other.value) {}
+  };
+}
+
+TEST(small_vector, growth_keeps_strong_guarantee) {
+  xlib::container::small_vector<throwing_copy, 2> v;
+  v.emplace_back(1);
+  v.emplace_back(2);
+
+  // The move constructor may throw, so growth copies and the failure leaves v untouched
+  throwing_copy::copies_left = 1;
+  EXPECT_THROW(v.emplace_back(3), std::runtime_error);
+  ASSERT_EQ(v.size(), 2u);
+  EXPECT_TRUE(v.is_inline());
+  EXPECT_EQ(v[0].value, 1);
+  EXPECT_EQ(v[1].value, 2);
+
+  throwing_copy::copies_left = 2;
+  v.emplace_back(3);
+  EXPECT_EQ(v.size(), 3u);
+  EXPECT_EQ(v[2].value, 3);
+}
+
+namespace {
+  template <typename T>
+  struct tagged_allocator : std::allocator<T> {
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using is_always_equal = std::false_type;
+
+    int tag = 0;
+
+    tagged_allocator(int tag = 0) noexcept : tag(tag) {}
+    template <typename U>
+    tagged_allocator(const tagged_allocator<U>& other) noexcept : tag(other.tag) {}
+
+    friend bool operator==(const tagged_allocator& lhs, const tagged_allocator& rhs) noexcept {
+      return lhs.tag == rhs.tag;
+    }
+  };
+}
+
+TEST(small_vector, move_assignment_propagates_allocator) {
+  xlib::container::small_vector<int, 1, tagged_allocator<int>> a(tagged_allocator<int>(1));
+  xlib::container::small_vector<int, 1, tagged_allocator<int>> b(tagged_allocator<int>(2));
+  b = {1, 2, 3};
+  const int* data = b.data();
+
+  a = std::move(b);
+  EXPECT_EQ(a.get_allocator().tag, 2);
+  EXPECT_EQ(a.data(), data);
+  EXPECT_EQ(a, (xlib::container::small_vector<int, 1, tagged_allocator<int>>{1, 2, 3}));
+}
+
+TEST(small_vector, graph_collection) {
+  xlib::graph<int> g;
+  g[1].push_back(2);
+  g[2].push_back(3);
+
+  EXPECT_EQ(g.findShortestPath(1, 3), std::make_pair(true, size_t{2}));
+}
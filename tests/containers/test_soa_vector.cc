@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include <containers/soa_vector.hpp>
+
+namespace {
+  struct counted {
+    static inline int alive = 0;
+    static inline int throw_after = -1;
+    int value = 0;
+
+    counted(int value = 0) : value(value) {
+      if (throw_after >= 0 && throw_after-- == 0)
+        throw std::runtime_error("counted");
+      ++alive;
+    }
+    counted(const counted& other) : counted(other.value) {}
+    ~counted() { --alive; }
+  };
+}
+
+TEST(soa_vector, fields_and_elements) {
+  xlib::container::soa_vector<int, std::string> v;
+  v.push_back(1, "one");
+  v.emplace_back(2, "two");
+  v.push_back(std::tuple(3, "three"));
+
+  ASSERT_EQ(v.size(), 3u);
+  auto [id, name] = v[1];
+  EXPECT_EQ(id, 2);
+  EXPECT_EQ(name, "two");
+
+  int sum = 0;
+  for (int x : v.get<0>())
+    sum += x;
+  EXPECT_EQ(sum, 6);
+
+  v.swap_erase(0);
+  EXPECT_EQ(std::get<1>(v[0]), "three");
+  v.erase(0);
+  EXPECT_EQ(std::get<1>(v.front()), "two");
+
+  v.resize(4);
+  EXPECT_EQ(std::get<0>(v.back()), 0);
+  EXPECT_TRUE(std::get<1>(v.back()).empty());
+}
+
+TEST(soa_vector, growth_with_aliased_arguments) {
+  xlib::container::soa_vector<int, std::string> v;
+  v.push_back(7, std::string(64, 'x'));
+
+  for (int i = 0; i < 100; ++i) {
+    v.push_back(v[0]);
+    auto [id, name] = v.back();
+    v.emplace_back(id, name);
+  }
+
+  ASSERT_EQ(v.size(), 201u);
+  for (auto [id, name] : v) {
+    EXPECT_EQ(id, 7);
+    EXPECT_EQ(name, std::string(64, 'x'));
+  }
+}
+
+TEST(soa_vector, throwing_field_does_not_leak) {
+  {
+    xlib::container::soa_vector<counted, counted, std::string> v;
+    v.emplace_back(1, 2, "a");
+    EXPECT_EQ(counted::alive, 2);
+
+    // The second field throws: the first one is destroyed again and v is unchanged
+    counted::throw_after = 1;
+    EXPECT_THROW(v.emplace_back(3, 4, "b"), std::runtime_error);
+    EXPECT_EQ(counted::alive, 2);
+    ASSERT_EQ(v.size(), 1u);
+    EXPECT_EQ(std::get<1>(v[0]).value, 2);
+
+    // Growth copies (counted's move may throw); a failed copy keeps the old elements
+    counted::throw_after = 2;
+    EXPECT_THROW(v.emplace_back(5, 6, "c"), std::runtime_error);
+    EXPECT_EQ(counted::alive, 2);
+    ASSERT_EQ(v.size(), 1u);
+    EXPECT_EQ(std::get<0>(v[0]).value, 1);
+
+    counted::throw_after = 3;
+    EXPECT_THROW(v.resize(3), std::runtime_error);
+    EXPECT_EQ(counted::alive, 2);
+    EXPECT_EQ(v.size(), 1u);
+
+    counted::throw_after = -1;
+    v.resize(3);
+    EXPECT_EQ(counted::alive, 6);
+  }
+  EXPECT_EQ(counted::alive, 0);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include <function/unique_function.hpp>
+
+TEST(unique_function, holds_move_only_callables) {
+  auto value = std::make_unique<int>(41);
+  xlib::unique_function<int(int)> f = [value = std::move(value)](int add) { return *value + add; };
+  EXPECT_TRUE(static_cast<bool>(f));
+  EXPECT_EQ(f(1), 42);
+
+  xlib::unique_function<int(int)> moved = std::move(f);
+  EXPECT_FALSE(static_cast<bool>(f));
+  EXPECT_EQ(moved(2), 43);
+
+  f = std::move(moved);
+  EXPECT_EQ(f(3), 44);
+  f.clear();
+  EXPECT_FALSE(static_cast<bool>(f));
+}
+
+TEST(unique_function, destroys_small_and_big_callables) {
+  auto counter = std::make_shared<int>(0);
+  {
+    // fits in the buffer
+    xlib::unique_function<void()> small = [counter] { ++*counter; };
+    // doesn't
+    std::array<char, 256> payload{};
+    xlib::unique_function<void()> big = [counter, payload] { *counter += payload[0] + 1; };
+
+    small();
+    big();
+    EXPECT_EQ(counter.use_count(), 3);
+
+    xlib::unique_function<void()> small_moved = std::move(small);
+    xlib::unique_function<void()> big_moved = std::move(big);
+    small_moved();
+    big_moved();
+    EXPECT_EQ(counter.use_count(), 3);
+  }
+  EXPECT_EQ(*counter, 4);
+  EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(unique_function, forwards_arguments_without_extra_moves) {
+  struct tracker {
+    int* moves;
+    explicit tracker(int* moves) : moves(moves) {}
+    tracker(tracker&& other) noexcept : moves(other.moves) { ++*moves; }
+  };
+
+  int moves = 0;
+  xlib::unique_function<int(tracker)> by_value = [](tracker t) { return *t.moves; };
+  EXPECT_EQ(by_value(tracker(&moves)), 1);
+
+  xlib::unique_function<std::string(const std::string&, int)> concat = [](const std::string& s, int n) {
+    return s + std::to_string(n);
+  };
+  int n = 2;
+  EXPECT_EQ(concat("x", n), "x2");
+}
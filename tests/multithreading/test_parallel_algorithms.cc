@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <multithreading/parallel_algorithms.hpp>
+
+TEST(parallel_algorithms, for_and_for_each) {
+  xlib::thread_pool pool(4);
+
+  std::vector<int> values(10007, 0);
+  xlib::parallel_for(pool, 0, static_cast<int>(values.size()), [&](int i) { values[i] += i; });
+  for (int i = 0; i < static_cast<int>(values.size()); ++i)
+    ASSERT_EQ(values[i], i);
+
+  xlib::parallel_for_each(pool, values.begin(), values.end(), [](int& value) { value *= 2; }, 100);
+  for (int i = 0; i < static_cast<int>(values.size()); ++i)
+    ASSERT_EQ(values[i], 2 * i);
+
+  // nested inside a task of the same pool
+  std::atomic<int> count = 0;
+  xlib::parallel_for(pool, 0, 16, [&](int) {
+    xlib::parallel_for(pool, 0, 100, [&](int) { ++count; }, 10);
+  }, 1);
+  EXPECT_EQ(count.load(), 1600);
+
+  xlib::parallel_for(pool, 5, 5, [](int) { FAIL(); });
+}
+
+TEST(parallel_algorithms, reduce_keeps_order) {
+  xlib::thread_pool pool(3);
+
+  std::vector<long> values(100000);
+  std::iota(values.begin(), values.end(), 1);
+  EXPECT_EQ(xlib::parallel_reduce(pool, values.begin(), values.end(), 0L), 5000050000L);
+
+  auto squares = xlib::parallel_transform_reduce(pool, values.begin(), values.begin() + 1000, 0L, std::plus<>(),
+                                                 [](long value) { return value * value; });
+  EXPECT_EQ(squares, 333833500L);
+
+  // concatenation is associative but not commutative
+  std::vector<std::string> letters;
+  for (char c = 'a'; c <= 'z'; ++c)
+    letters.emplace_back(1, c);
+  auto joined = xlib::parallel_reduce(pool, letters.begin(), letters.end(), std::string(">"), std::plus<>(), 3);
+  EXPECT_EQ(joined, ">abcdefghijklmnopqrstuvwxyz");
+}
+
+TEST(parallel_algorithms, scan) {
+  xlib::thread_pool pool(4);
+
+  std::vector<int> values(12345);
+  std::mt19937 random(1);
+  for (int& value : values)
+    value = static_cast<int>(random() % 100);
+
+  std::vector<int> expected(values.size());
+  std::inclusive_scan(values.begin(), values.end(), expected.begin());
+
+  std::vector<int> result(values.size());
+  auto end = xlib::parallel_scan(pool, values.begin(), values.end(), result.begin());
+  EXPECT_EQ(end, result.end());
+  EXPECT_EQ(result, expected);
+
+  // in place, with small chunks
+  xlib::parallel_scan(pool, values.begin(), values.end(), values.begin(), std::plus<>(), 7);
+  EXPECT_EQ(values, expected);
+}
+
+TEST(parallel_algorithms, sort) {
+  xlib::thread_pool pool(4);
+  std::mt19937 random(2);
+
+  std::vector<int> values(200000);
+  for (int& value : values)
+    value = static_cast<int>(random() % 1000); // many duplicates
+  auto expected = values;
+  std::sort(expected.begin(), expected.end(), std::greater<>());
+
+  xlib::parallel_sort(pool, values.begin(), values.end(), std::greater<>(), 500);
+  EXPECT_EQ(values, expected);
+
+  std::vector<int> sorted(50000);
+  std::iota(sorted.begin(), sorted.end(), 0);
+  auto copy = sorted;
+  xlib::parallel_sort(pool, copy.begin(), copy.end());
+  EXPECT_EQ(copy, sorted);
+}
+
+TEST(parallel_algorithms, rethrows_exceptions) {
+  xlib::thread_pool pool(2);
+  std::atomic<int> count = 0;
+
+  EXPECT_THROW(
+    xlib::parallel_for(pool, 0, 1000, [&](int i) {
+      ++count;
+      if (i == 500)
+        throw std::runtime_error("element");
+    }, 10),
+    std::runtime_error
+  );
+  // only the rest of the failed chunk is skipped
+  EXPECT_GE(count.load(), 991);
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <multithreading/spsc_ring.hpp>
+#include <multithreading/mpmc_ring.hpp>
+
+TEST(spsc_ring, transfers_in_order) {
+  xlib::spsc_ring<int, 64> ring;
+  constexpr int count = 100000;
+
+  std::thread producer([&] {
+    int batch[8];
+    for (int i = 0; i < count;) {
+      int n = std::min(8, count - i);
+      std::iota(batch, batch + n, i);
+      std::size_t pushed = ring.try_push_n(batch, n);
+      i += static_cast<int>(pushed);
+      if (pushed == 0)
+        std::this_thread::yield();
+    }
+  });
+
+  int expected = 0;
+  int batch[8];
+  while (expected < count) {
+    std::size_t n = ring.try_pop_n(batch, 8);
+    if (n == 0)
+      std::this_thread::yield();
+    for (std::size_t i = 0; i < n; ++i)
+      ASSERT_EQ(batch[i], expected++);
+  }
+  producer.join();
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(mpmc_ring, many_producers_and_consumers) {
+  xlib::mpmc_ring<long> ring(100);
+  EXPECT_EQ(ring.capacity(), 128u);
+
+  constexpr long per_producer = 20000;
+  constexpr int producers = 3, consumers = 3;
+  std::atomic<long> sum = 0, popped = 0;
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&] {
+      for (long i = 1; i <= per_producer;) {
+        if (i % 2 == 0) {
+          long batch[2] = {i, i + 1};
+          i += static_cast<long>(ring.try_push_n(batch, i + 1 <= per_producer ? 2 : 1));
+        }
+        else if (ring.try_push(i)) {
+          ++i;
+        }
+        else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&] {
+      long batch[4];
+      while (popped.load() < per_producer * producers) {
+        std::size_t n = ring.try_pop_n(batch, 4);
+        for (std::size_t i = 0; i < n; ++i)
+          sum += batch[i];
+        popped += static_cast<long>(n);
+        if (n == 0)
+          std::this_thread::yield();
+      }
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+
+  EXPECT_EQ(sum.load(), producers * per_producer * (per_producer + 1) / 2);
+}
+
+namespace {
+  // Throws when copied from a negative value.
+  struct picky {
+    static inline int alive = 0;
+    int value;
+
+    picky(int v) : value(v) { ++alive; }
+    picky(const picky& other) : value(other.value) {
+      if (value < 0)
+        throw std::runtime_error("picky");
+      ++alive;
+    }
+    picky(picky&& other) noexcept : value(other.value) { ++alive; }
+    picky& operator=(const picky&) = default;
+    picky& operator=(picky&&) noexcept = default;
+    ~picky() { --alive; }
+  };
+
+  std::vector<picky> make_picky(std::initializer_list<int> values) {
+    std::vector<picky> result;
+    for (int v : values)
+      result.emplace_back(v);
+    return result;
+  }
+}
+
+TEST(spsc_ring, throwing_push_n_destroys_what_it_built) {
+  {
+    xlib::spsc_ring<picky, 8> ring;
+    std::vector<picky> values = make_picky({1, 2, -1, 4});
+    EXPECT_THROW(ring.try_push_n(values.begin(), values.size()), std::runtime_error);
+    EXPECT_EQ(picky::alive, 4);
+
+    picky out(0);
+    EXPECT_FALSE(ring.try_pop(out));
+    EXPECT_EQ(ring.try_push_n(values.begin(), 2), 2u);
+    EXPECT_TRUE(ring.try_pop(out));
+    EXPECT_EQ(out.value, 1);
+  }
+  EXPECT_EQ(picky::alive, 0);
+}
+
+TEST(mpmc_ring, throwing_constructor_does_not_block_the_ring) {
+  {
+    xlib::mpmc_ring<picky> ring(8);
+    picky bad(-1);
+    EXPECT_THROW(ring.try_emplace(bad), std::runtime_error);
+
+    std::vector<picky> values = make_picky({1, 2, -1, 4});
+    EXPECT_THROW(ring.try_push_n(values.begin(), values.size()), std::runtime_error);
+
+    picky out(0);
+    ASSERT_TRUE(ring.try_pop(out));
+    EXPECT_EQ(out.value, 1);
+    ASSERT_TRUE(ring.try_pop(out));
+    EXPECT_EQ(out.value, 2);
+    EXPECT_FALSE(ring.try_pop(out));
+
+    EXPECT_TRUE(ring.try_emplace(5));
+    ASSERT_TRUE(ring.try_pop(out));
+    EXPECT_EQ(out.value, 5);
+  }
+  EXPECT_EQ(picky::alive, 0);
+}
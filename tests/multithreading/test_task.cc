@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <multithreading/task.hpp>
+
+namespace {
+  xlib::task<int> value(int v) {
+    co_return v;
+  }
+
+  xlib::task<int> add(int a, int b) {
+    int x = co_await value(a);
+    int y = co_await value(b);
+    co_return x + y;
+  }
+
+  xlib::task<int> square_on(xlib::thread_pool& pool, int v) {
+    co_await xlib::schedule_on(pool);
+    co_return v * v;
+  }
+
+  xlib::task<void> fail_on(xlib::thread_pool& pool) {
+    co_await xlib::schedule_on(pool);
+    throw std::runtime_error("task");
+  }
+}
+
+TEST(task, awaits_nested_tasks) {
+  EXPECT_EQ(xlib::sync_wait(add(40, 2)), 42);
+
+  auto make_pointer = []() -> xlib::task<std::unique_ptr<int>> { co_return std::make_unique<int>(7); };
+  EXPECT_EQ(*xlib::sync_wait(make_pointer()), 7);
+
+  // synchronously completing tasks in a long loop must not grow the stack
+  auto loop = []() -> xlib::task<long> {
+    long sum = 0;
+    for (int i = 0; i < 200000; ++i)
+      sum += co_await value(1);
+    co_return sum;
+  };
+  EXPECT_EQ(xlib::sync_wait(loop()), 200000);
+}
+
+TEST(task, schedule_on_moves_to_the_pool) {
+  xlib::thread_pool pool(2);
+  auto caller = std::this_thread::get_id();
+
+  auto where = [&]() -> xlib::task<std::thread::id> {
+    co_await xlib::schedule_on(pool);
+    co_return std::this_thread::get_id();
+  };
+  EXPECT_NE(xlib::sync_wait(where()), caller);
+
+  EXPECT_THROW(xlib::sync_wait(fail_on(pool)), std::runtime_error);
+}
+
+TEST(task, when_all) {
+  xlib::thread_pool pool(4);
+
+  auto both = [&]() -> xlib::task<int> {
+    auto [a, b, nothing] = co_await xlib::when_all(square_on(pool, 3), add(1, 2), value(0));
+    co_return a + b + nothing;
+  };
+  EXPECT_EQ(xlib::sync_wait(both()), 12);
+
+  std::vector<xlib::task<int>> tasks;
+  for (int i = 0; i < 100; ++i)
+    tasks.push_back(square_on(pool, i));
+  auto squares = xlib::sync_wait(xlib::when_all(std::move(tasks)));
+  ASSERT_EQ(squares.size(), 100u);
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(squares[i], i * i);
+}
+
+TEST(task, when_all_rethrows_after_all_finished) {
+  xlib::thread_pool pool(2);
+  std::atomic<int> finished = 0;
+  auto count = [&]() -> xlib::task<void> {
+    co_await xlib::schedule_on(pool);
+    ++finished;
+  };
+  EXPECT_THROW(xlib::sync_wait(xlib::when_all(count(), fail_on(pool), count())), std::runtime_error);
+  EXPECT_EQ(finished.load(), 2);
+}
+
+TEST(task, when_any) {
+  xlib::thread_pool pool(2);
+
+  auto slow = [&]() -> xlib::task<int> {
+    co_await xlib::schedule_on(pool);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    co_return 1;
+  };
+
+  // value(2) finishes synchronously, so the third task is never started
+  auto first = xlib::sync_wait(xlib::when_any(slow(), value(2), slow()));
+  EXPECT_EQ(first.index, 1u);
+  EXPECT_EQ(first.value, 2);
+
+  std::vector<xlib::task<int>> tasks;
+  tasks.push_back(slow());
+  tasks.push_back(square_on(pool, 5));
+  auto any = xlib::sync_wait(xlib::when_any(std::move(tasks)));
+  EXPECT_TRUE((any.index == 0 && any.value == 1) || (any.index == 1 && any.value == 25));
+
+  EXPECT_THROW(xlib::sync_wait(xlib::when_any(std::vector<xlib::task<int>>())), std::invalid_argument);
+}
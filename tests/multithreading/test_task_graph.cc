@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include <multithreading/task_graph.hpp>
+
+TEST(task_graph, runs_tasks_after_their_dependencies) {
+  xlib::thread_pool pool(4);
+  xlib::task_graph graph;
+
+  // each task records its position; a task must come after all of its dependencies
+  std::atomic<int> clock = 0;
+  std::vector<int> finished(6, -1);
+  auto task = [&](int i) { return [&, i] { finished[i] = clock++; }; };
+
+  auto a = graph.add(task(0));
+  auto b = graph.add(task(1), {a});
+  auto c = graph.add(task(2), {a});
+  auto d = graph.add(task(3), {b, c});
+  auto e = graph.add(task(4));
+  auto f = graph.add(task(5), {d, e});
+
+  for (int run = 0; run < 3; ++run) {
+    clock = 0;
+    graph.run(pool);
+    EXPECT_EQ(clock.load(), 6);
+    EXPECT_LT(finished[a], finished[b]);
+    EXPECT_LT(finished[a], finished[c]);
+    EXPECT_LT(finished[b], finished[d]);
+    EXPECT_LT(finished[c], finished[d]);
+    EXPECT_LT(finished[d], finished[f]);
+    EXPECT_LT(finished[e], finished[f]);
+  }
+}
+
+TEST(task_graph, wide_fan_out_and_in) {
+  xlib::thread_pool pool(3);
+  xlib::task_graph graph;
+  std::atomic<int> sum = 0;
+  int result = 0;
+
+  auto source = graph.add([] {});
+  auto sink = graph.add([&] { result = sum.load(); });
+  for (int i = 1; i <= 200; ++i) {
+    auto middle = graph.add([&sum, i] { sum += i; }, {source});
+    graph.precede(middle, sink);
+  }
+
+  graph.run(pool);
+  EXPECT_EQ(result, 20100);
+}
+
+TEST(task_graph, runs_inside_the_pool) {
+  // with one worker, waiting inside a task would deadlock if run() blocked
+  xlib::thread_pool pool(1);
+  xlib::task_graph graph;
+  std::atomic<int> count = 0;
+  auto first = graph.add([&] { ++count; });
+  graph.add([&] { ++count; }, {first});
+
+  auto done = pool.enqueue([&] { graph.run(pool); return count.load(); });
+  EXPECT_EQ(done.get(), 2);
+}
+
+TEST(task_graph, start_calls_completion) {
+  xlib::thread_pool pool(2);
+  xlib::task_graph graph;
+  std::atomic<int> count = 0;
+  auto first = graph.add([&] { ++count; });
+  graph.add([&] { ++count; }, {first});
+  graph.add([&] { ++count; }, {first});
+
+  std::promise<int> finished;
+  graph.start(pool, [&](std::exception_ptr error) { finished.set_value(error == nullptr ? count.load() : -1); });
+  EXPECT_EQ(finished.get_future().get(), 3);
+}
+
+TEST(task_graph, errors) {
+  xlib::thread_pool pool(2);
+
+  xlib::task_graph failing;
+  bool dependent_ran = false;
+  auto thrower = failing.add([] { throw std::runtime_error("task"); });
+  failing.add([&] { dependent_ran = true; }, {thrower});
+  EXPECT_THROW(failing.run(pool), std::runtime_error);
+  EXPECT_FALSE(dependent_ran);
+
+  xlib::task_graph cyclic;
+  auto a = cyclic.add([] {});
+  auto b = cyclic.add([] {}, {a});
+  cyclic.precede(b, a);
+  EXPECT_THROW(cyclic.run(pool), std::logic_error);
+
+  EXPECT_THROW(cyclic.add([] {}, {42}), std::out_of_range);
+
+  xlib::task_graph empty;
+  empty.run(pool);
+}
@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <latch>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <multithreading/numa_topology.hpp>
+#include <multithreading/thread_pool.hpp>
+#include <multithreading/work_stealing_deque.hpp>
+
+TEST(work_stealing_deque, every_element_taken_once) {
+  constexpr int count = 20000, thieves_count = 3;
+  xlib::work_stealing_deque<int> deque(4);
+  std::vector<std::atomic<int>> taken(count);
+  std::atomic<bool> done = false;
+
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < thieves_count; ++t) {
+    thieves.emplace_back([&] {
+      while (!done.load() || !deque.empty()) {
+        if (auto value = deque.steal())
+          taken[*value].fetch_add(1);
+        else
+          std::this_thread::yield();
+      }
+    });
+  }
+
+  for (int i = 0; i < count; ++i) {
+    deque.push(i);
+    if (i % 3 == 0) {
+      if (auto value = deque.pop())
+        taken[*value].fetch_add(1);
+    }
+  }
+  while (auto value = deque.pop())
+    taken[*value].fetch_add(1);
+  done = true;
+
+  for (auto& thief : thieves)
+    thief.join();
+  for (int i = 0; i < count; ++i)
+    ASSERT_EQ(taken[i].load(), 1) << i;
+}
+
+TEST(thread_pool, runs_nested_tasks) {
+  xlib::thread_pool pool(4);
+
+  auto answer = pool.enqueue([](int a, int b) { return a * b; }, 6, 7);
+  EXPECT_EQ(answer.get(), 42);
+
+  // every task spawns two children from inside the pool until depth 10
+  constexpr int depth = 10;
+  std::atomic<int> executed = 0;
+  std::latch all_done((1 << (depth + 1)) - 1);
+
+  std::function<void(int)> spawn = [&](int level) {
+    ++executed;
+    if (level < depth) {
+      pool.enqueue(spawn, level + 1);
+      pool.enqueue(spawn, level + 1);
+    }
+    all_done.count_down();
+  };
+  pool.enqueue(spawn, 0);
+  all_done.wait();
+
+  EXPECT_EQ(executed.load(), (1 << (depth + 1)) - 1);
+}
+
+TEST(thread_pool, destructor_drains_queue) {
+  std::atomic<int> executed = 0;
+  {
+    xlib::thread_pool pool(2);
+    for (int i = 0; i < 1000; ++i)
+      pool.enqueue([&] { ++executed; });
+  }
+  EXPECT_EQ(executed.load(), 1000);
+}
+
+TEST(thread_pool, post_and_move_only_tasks) {
+  std::atomic<int> sum = 0;
+  {
+    xlib::thread_pool pool(3);
+    for (int i = 1; i <= 1000; ++i)
+      pool.post([&sum, i] { sum += i; });
+
+    auto value = std::make_unique<int>(7);
+    auto result = pool.enqueue([value = std::move(value)] { return *value * 6; });
+    EXPECT_EQ(result.get(), 42);
+
+    auto failed = pool.enqueue([] { throw std::runtime_error("task"); });
+    EXPECT_THROW(failed.get(), std::runtime_error);
+  }
+  EXPECT_EQ(sum.load(), 500500);
+}
+
+TEST(thread_pool, options) {
+  // CPU 0 may be outside the affinity mask of the runner
+  int cpu = xlib::allowed_cpus().back();
+
+  xlib::thread_pool_options options;
+  options.threads = 2;
+  options.name = "a-very-long-pool-name";
+  options.cpus = {cpu};
+  xlib::thread_pool pool(options);
+  EXPECT_EQ(pool.size(), 2u);
+
+#ifdef __linux__
+  auto name = pool.enqueue([] {
+    char buffer[16] = {};
+    pthread_getname_np(pthread_self(), buffer, sizeof(buffer));
+    return std::string(buffer);
+  });
+  std::string worker_name = name.get();
+  EXPECT_TRUE(worker_name == "a-very-long-p-0" || worker_name == "a-very-long-p-1") << worker_name;
+
+  EXPECT_EQ(pool.enqueue([] { return sched_getcpu(); }).get(), cpu);
+#endif
+
+  options.cpus = {-1};
+  EXPECT_THROW(xlib::thread_pool bad(options), std::invalid_argument);
+}
+
+TEST(thread_pool, default_pool_is_created_on_first_use) {
+  // The checks run in a freshly started copy of the test binary, so they don't depend on
+  // whether other tests (or an earlier --gtest_repeat round) already used the default pool.
+  // The style is restored afterwards so later death tests keep the one they were run with.
+  struct death_test_style_guard {
+    std::string saved = GTEST_FLAG_GET(death_test_style);
+    ~death_test_style_guard() { GTEST_FLAG_SET(death_test_style, saved); }
+  } style_guard;
+  GTEST_FLAG_SET(death_test_style, "threadsafe");
+
+  auto check = [] {
+    const auto& state = xlib::detail::default_thread_pool_state_instance();
+    xlib::thread_pool_options options;
+    options.threads = 2;
+    xlib::configure_default_thread_pool(options);
+    if (state.created.load() != nullptr)
+      std::exit(1);
+
+    xlib::thread_pool& pool = xlib::default_thread_pool();
+    if (state.created.load() != &pool || &xlib::default_thread_pool() != &pool || pool.size() != 2)
+      std::exit(2);
+    if (pool.enqueue([] { return 42; }).get() != 42)
+      std::exit(3);
+
+    try {
+      xlib::configure_default_thread_pool(options);
+      std::exit(4);
+    }
+    catch (const std::logic_error&) {}
+    std::exit(0);
+  };
+  EXPECT_EXIT(check(), ::testing::ExitedWithCode(0), "");
+}
+
+TEST(thread_pool, parse_cpu_list) {
+  EXPECT_EQ(xlib::parse_cpu_list("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(xlib::parse_cpu_list("5,1,x,3-2,1"), (std::vector<int>{1, 5}));
+  EXPECT_TRUE(xlib::parse_cpu_list("").empty());
+
+  // every CPU of the topology may be used, and the fallback covers the affinity mask too
+  auto allowed = xlib::allowed_cpus();
+  ASSERT_FALSE(allowed.empty());
+  EXPECT_TRUE(std::is_sorted(allowed.begin(), allowed.end()));
+
+  auto topology = xlib::numa_topology();
+  ASSERT_FALSE(topology.empty());
+  for (const auto& node : topology) {
+    EXPECT_FALSE(node.cpus.empty());
+    for (int cpu : node.cpus)
+      EXPECT_TRUE(std::binary_search(allowed.begin(), allowed.end(), cpu)) << cpu;
+  }
+
+  xlib::thread_pool pool(1);
+  ASSERT_EQ(pool.nodes().size(), 1u);
+  EXPECT_EQ(pool.nodes()[0].cpus, allowed);
+}
+
+TEST(thread_pool, numa_placement) {
+  xlib::thread_pool_options options;
+  options.threads = 3;
+  options.placement = xlib::worker_placement::cores;
+  xlib::thread_pool pool(options);
+
+  const auto& nodes = pool.nodes();
+  ASSERT_FALSE(nodes.empty());
+  for (size_t worker = 0; worker < pool.size(); ++worker) {
+    size_t node = pool.worker_node(worker);
+    ASSERT_LT(node, nodes.size());
+    ASSERT_EQ(pool.worker_cpus(worker).size(), 1u);
+    const auto& cpus = nodes[node].cpus;
+    EXPECT_NE(std::find(cpus.begin(), cpus.end(), pool.worker_cpus(worker)[0]), cpus.end());
+  }
+
+  std::atomic<int> count = 0;
+  for (size_t node = 0; node < nodes.size(); ++node) {
+    for (int i = 0; i < 100; ++i)
+      pool.post_on_node(node, [&] { ++count; });
+  }
+  EXPECT_EQ(pool.enqueue_on_node(nodes.size() - 1, [] { return 7; }).get(), 7);
+  EXPECT_THROW(pool.post_on_node(nodes.size(), [] {}), std::out_of_range);
+
+  // tasks posted to a node from inside a worker of that node stay local
+  auto nested = pool.enqueue_on_node(0, [&] {
+    std::promise<int> inner;
+    auto result = inner.get_future();
+    pool.post_on_node(0, [&] { inner.set_value(1); });
+    while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      pool.run_pending_task();
+    return result.get();
+  });
+  EXPECT_EQ(nested.get(), 1);
+
+  while (count.load() != static_cast<int>(100 * nodes.size()))
+    std::this_thread::yield();
+
+  options.placement = xlib::worker_placement::numa_nodes;
+  xlib::thread_pool grouped(options);
+  for (size_t worker = 0; worker < grouped.size(); ++worker)
+    EXPECT_EQ(grouped.worker_cpus(worker), grouped.nodes()[grouped.worker_node(worker)].cpus);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+
+namespace xlib {
+  // std::hardware_destructive_interference_size isn't ABI-stable across compiler flags,
+  // so use the common x86-64/AArch64 value.
+  inline constexpr std::size_t cache_line_size = 64;
+}
@@ -5,6 +5,8 @@
 #include <memory>
 #include <functional>
 
+#include "../allocators/memory_resource/slab_memory_resource.hpp"
+
 namespace xlib {
 
 #define STACK_MAX_SIZE 256
@@ -103,6 +105,9 @@ private:
 	size_t stackSize = 0;
 	IObject* begin = nullptr;
 
+	// Objects of one type share slabs, and freed objects are reused by the next create().
+	slab_memory_resource objects;
+
 	size_t count_objects = 0;
 	size_t max_objects = IGCT;
 
@@ -126,7 +131,18 @@ private:
 
   template <typename T, typename... Args>
 	Object<T>* create(Args&&... args) {
-    Object<T>* object = new Object<T>(states::basic, begin, std::forward<Args>(args)...);
+    static_assert(sizeof(Object<T>) <= slab_memory_resource::max_object_size && alignof(Object<T>) <= alignof(std::max_align_t),
+                  "xlib::virtual_machine: objects must fit into a slab");
+
+    void* memory = objects.allocate(sizeof(Object<T>), alignof(Object<T>));
+    Object<T>* object;
+    try {
+      object = new (memory) Object<T>(states::basic, begin, std::forward<Args>(args)...);
+    }
+    catch (...) {
+      objects.deallocate(memory, sizeof(Object<T>), alignof(Object<T>));
+      throw;
+    }
 		begin = object;
 
 		count_objects++;
@@ -146,6 +162,7 @@ private:
 
 				*object = unreached->get_next();
 				unreached->~IObject();
+				slab_memory_resource::free(unreached);
 
 				count_objects--;
 			}